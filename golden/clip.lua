@@ -0,0 +1,36 @@
+-- 裁剪越界回归: 尝试经内存把裁剪区域写到 128 之外, 再向额外表面批量绘制与绘制缓存地图
+-- 越界的点与精灵必须被丢弃, 结果复制到屏幕上比对
+
+local t = 0
+
+function init()
+    memset(0x2000, 0x76, 0x2000)
+    memset(0x4000, 1, 0x4000)
+    mapcache(true)
+end
+
+function update()
+    t = t + 1
+end
+
+function draw()
+    clip(100, 100, 200, 200)
+    poke(0x94CA + 2, 255)
+    poke(0x94CA + 3, 255)
+    memset(0x94CA, 255, 4)
+
+    target(2)
+    cls(1)
+    psetn({200, 200, 5, 127, 127, 6, 100 + t % 28, 100, 7, 300, 20, 8})
+    sprn({1, 124, 124, 0, 1, 200, 200, 0, 1, 96 + t % 40, 110, 0})
+
+    target(3)
+    cls(2)
+    map(0, 0, 128, 128, -(t % 8), 0)
+
+    target(0)
+    clip()
+    cls(0)
+    blit(2, 64, 64, 64, 64, 0, 0, 0)
+    blit(3, 64, 64, 64, 64, 0, 64, 64)
+end
@@ -16,6 +16,9 @@ namespace t8 {
     constexpr uint32_t SIGNAL_STOP_INPUT = 4;
     constexpr uint32_t SIGNAL_PRINT = 5;
     constexpr uint32_t SIGNAL_EXCEPTION = 6;
+    constexpr uint32_t SIGNAL_REPORT = 7;
+    // 紧随 SIGNAL_EXCEPTION, 每个信号携带调用栈的一行
+    constexpr uint32_t SIGNAL_TRACE = 8;
 
     constexpr auto SCANCODE_ESC = SDL_SCANCODE_ESCAPE;
     constexpr auto SCANCODE_LEFT = SDL_SCANCODE_LEFT;
@@ -31,6 +34,8 @@ namespace t8 {
     constexpr auto SCANCODE_R = SDL_SCANCODE_R;
     constexpr auto SCANCODE_Y = SDL_SCANCODE_Y;
     constexpr auto SCANCODE_Z = SDL_SCANCODE_Z;
+    constexpr auto SCANCODE_REWIND = SDL_SCANCODE_BACKSPACE;
+    constexpr auto SCANCODE_PROFILE = SDL_SCANCODE_F9;
 
     constexpr auto EDITOR_PENCIL = 1;
     constexpr auto EDITOR_STRAW = 2;
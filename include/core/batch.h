@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+#include <string_view>
+#include <vector>
+
+namespace t8::core {
+    struct VirtualMemory;
+}
+
+namespace t8::core {
+    enum DrawOp : uint8_t {
+        DRAW_PSET,
+        DRAW_LINE,
+        DRAW_RECT,
+        DRAW_RECTFILL,
+        DRAW_CIRC,
+        DRAW_CIRCFILL,
+        DRAW_SPR,
+        DRAW_CHAR,
+    };
+
+    // 紧凑的绘制命令, 参数含义随 op 变化:
+    // PSET x y | LINE x0 y0 x1 y1 | RECT x y w h | CIRC x y r
+    // SPR x y scale flags (color 为精灵编号) | CHAR x y ch custom
+    struct DrawCmd {
+        uint8_t op;
+        uint8_t color;
+        int16_t a, b, c, d;
+    };
+
+    struct DrawBatch {
+        std::vector<DrawCmd> cmds;
+        std::vector<DrawCmd> scratch;
+        // 为 false 时允许按 op 与颜色重排以合并状态, 适合互不重叠的粒子等
+        bool ordered{true};
+    };
+
+    void bat_push(DrawBatch &batch, uint8_t op, uint8_t color, int a, int b, int c = 0, int d = 0);
+
+    void bat_text(DrawBatch &batch, std::string_view s, int x, int y, uint8_t color, int w0 = 4, int w1 = 8);
+
+    void bat_clear(DrawBatch &batch);
+
+    // 依次执行并清空命令, 返回执行的命令数
+    size_t bat_flush(VirtualMemory *m, DrawBatch &batch);
+
+    // 立即绘制 count 个点, xyc 为连续的 x, y, c 三元组
+    void bat_points(VirtualMemory *m, const int16_t *xyc, size_t count);
+
+    // 立即绘制 count 个 8x8 精灵, quads 为连续的 id, x, y, flags 四元组, flags 同 gfx_spr
+    void bat_sprites(VirtualMemory *m, const int16_t *quads, size_t count);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+namespace t8::core {
+    struct AppContext;
+}
+
+namespace t8::core {
+    // 载入 zip 卡带, 或者单独的 .lua 脚本 (记录路径, 运行中文件变化会触发热重载)
+    bool cart_load(AppContext &ctx, const std::string &file_name);
+
+    // compile 为 true 时附带预编译的字节码; 失败时写入 error
+    bool cart_save(AppContext &ctx, const std::string &file_name, bool compile, std::string &error);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+namespace t8::core {
+    struct VirtualMemory;
+}
+
+namespace t8::core {
+    constexpr uint8_t RAY_RIGHT = 0;
+    constexpr uint8_t RAY_LEFT = 1;
+    constexpr uint8_t RAY_DOWN = 2;
+    constexpr uint8_t RAY_UP = 3;
+
+    struct SweepResult {
+        int x, y;
+        bool hit_x, hit_y;
+    };
+
+    // 以下查询均以地图格为单位, mask 匹配精灵标志的任意一位; 地图外视为空
+
+    bool col_any(VirtualMemory *m, uint8_t mask, int x, int y, int w, int h);
+
+    int col_ray(VirtualMemory *m, uint8_t mask, int x, int y, uint8_t dir, int max = 128);
+
+    // 像素坐标的 AABB 先沿 x 后沿 y 移动, 停在第一个匹配的格子前
+    SweepResult col_sweep(VirtualMemory *m, uint8_t mask, int x, int y, int w, int h, int dx, int dy);
+
+    void col_touch_tile(VirtualMemory *m, int x, int y);
+
+    void col_touch_sprite(VirtualMemory *m, uint8_t n);
+
+    void col_invalidate(VirtualMemory *m);
+}
@@ -1,44 +1,82 @@
 #pragma once
-#include <queue>
 #include <string>
-#include <variant>
+#include <vector>
 
 #include "core/memory.h"
+#include "core/rewind.h"
 #include "core/window.h"
 #include "input/mouse.h"
 #include "input/keyboard.h"
 #include "input/gamepad.h"
+#include "input/replay.h"
 
+#include "utils/fixed_string.hpp"
+#include "utils/ring_queue.hpp"
 #include "utils/timer.hpp"
 
 namespace t8::core {
 
+    // 一行文本; 脚本错误的调用栈按行拆成多个信号 (见 SIGNAL_TRACE)
+    using SignalText = utils::FixedString<255>;
+    using InputText = utils::FixedString<31>;
+
     struct Signal {
         uint32_t type;
-        std::variant<
-            std::monostate,
-            std::string>
-            value;
+        SignalText value;
+    };
+
+    // base_memory 与 exec_memory 之间可能不同的页
+    struct PageTable {
+        // 上次进入执行器之后 base_memory 中写入过的页 (编辑器与载入卡带)
+        PageSet edited;
+        // exec_memory 中写入过的页, 离开执行器后保留, 即运行对卡带镜像造成的改动;
+        // exec_memory 初始未与 base_memory 同步, 因此全部置位
+        PageSet written = PageSet().set();
     };
 
     struct AppContext {
         VirtualMemory base_memory;
         VirtualMemory exec_memory;
         VirtualMemory *memory = &base_memory;
+        PageTable pages;
 
         std::string script;
+        // 由 script 预编译的字节码, 与源码不一致时忽略
+        std::vector<uint8_t> bytecode;
+        // Lua 不校验字节码, 恶意构造的 script.luac 可以破坏 VM; 只有 --bytecode 开启时才加载
+        bool load_bytecode = false;
+        // 从单独的 .lua 文件载入时记录路径, 运行中文件变化会触发热重载
+        std::string script_path;
 
         input::MouseState mouse;
         input::KeyboardState keyboard;
         input::GamepadState gamepad;
         WindowState window;
+        input::InputRecorder recorder;
 
-        std::queue<std::string> inputs;
-        std::queue<Signal> signals;
+        utils::RingQueue<InputText, 64> inputs;
+        utils::RingQueue<Signal, 256> signals;
 
         utils::Timer timer;
 
+        RewindState rewind;
+
+        // 当前场景 SCENE_ID_*, 尚未进入任何场景时为 -1
+        int scene = -1;
+
         uint32_t pixel_size = 3;
+        // 为 true 时脚本在单独的模拟线程中运行
+        bool threaded = true;
+        // 无窗口校验与录制/回放时为 true: time() 只随执行的 tick 前进, 随机数以 seed 初始化
+        bool deterministic = false;
+        uint64_t seed = 0;
         uint32_t buffer[128 * 128];
     };
+
+    // 进入执行器时只把 edited | written 中的页从 base_memory 复制到 exec_memory, 然后清空两者;
+    // 离开时切回 base_memory, exec_memory 与 written 保留到下一次进入
+    void ctx_swap_memory(AppContext *ctx, bool exec);
+
+    // 运行状态与编辑中的卡带镜像之间可能不同的页
+    PageSet ctx_changed_pages(const AppContext *ctx);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <functional>
+#include <string>
 #include <unordered_map>
 
 #include "core/context.h"
@@ -11,4 +12,6 @@ namespace t8::core
     void emu_run(AppContext *ctx);
 
     void emu_quit(AppContext *ctx);
+
+    int emu_verify(AppContext *ctx, const std::string &cart_file, const std::string &input_file, const std::string &golden_file, bool update);
 }
\ No newline at end of file
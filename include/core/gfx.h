@@ -6,12 +6,19 @@ namespace t8::core {
 }
 
 namespace t8::core {
+    constexpr uint8_t SURFACE_SCREEN = 0;
+    constexpr uint8_t SURFACE_SPRITE = 1;
+    constexpr uint8_t SURFACE_EXTRA = 2;
+    constexpr uint8_t SURFACE_EXTRA_COUNT = 4;
+
     void gfx_reset(VirtualMemory *m);
 
     void gfx_clip(VirtualMemory *m, int x = 0, int y = 0, int w = 128, int h = 128);
 
     void gfx_camera(VirtualMemory *m, int8_t x = 0, int8_t y = 0);
 
+    bool gfx_target(VirtualMemory *m, uint8_t id = SURFACE_SCREEN);
+
     void gfx_clear(VirtualMemory *m, uint8_t c);
 
     void gfx_palt(VirtualMemory *m, uint8_t c, bool t);
@@ -54,4 +61,20 @@ namespace t8::core {
 
     void gfx_rect(VirtualMemory *m, int x, int y, int w, int h, uint8_t color, bool fill = false);
 
+    // flags: 位 0 水平翻转, 位 1 垂直翻转, 位 2 旋转 90 度, 位 3 旋转 180 度
+    void gfx_spr(VirtualMemory *m, uint8_t n, int x, int y, int scale = 1, uint8_t flags = 0);
+
+    // 额外表面位于 VirtualMemory 之外, 不随回退还原, 只有 blit 到屏幕的结果进入 golden 哈希
+    uint8_t *gfx_surface(VirtualMemory *m, uint8_t id);
+
+    void gfx_release_surfaces();
+
+    void gfx_map(VirtualMemory *m, int mx, int my, int mw, int mh, int sx, int sy, int scale = 1, uint8_t layers = 0xFF);
+
+    void gfx_map_cache(bool enable);
+
+    void gfx_map_invalidate(VirtualMemory *m);
+
+    void gfx_blit(VirtualMemory *m, uint8_t src, int sx, int sy, int w, int h, uint8_t dst, int dx, int dy, int key = -1);
+
 }
\ No newline at end of file
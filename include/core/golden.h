@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace t8::core {
+    struct VirtualMemory;
+}
+
+namespace t8::core {
+    // 屏幕内容加上解析后的调色板, 即玩家实际看到的一帧
+    struct GoldenFrame {
+        uint8_t screen[0x2000];
+        uint32_t palette[16];
+    };
+
+    // 每 tick 一条记录: [u64 哈希][varint 长度][与上一帧的 XOR 差分]
+    struct GoldenFile {
+        std::vector<uint8_t> data;
+        size_t cursor = 0;
+        GoldenFrame frame{};
+    };
+
+    void gld_capture(VirtualMemory *m, GoldenFrame &f);
+
+    uint64_t gld_hash(const GoldenFrame &f);
+
+    void gld_reset(GoldenFile &g);
+
+    void gld_append(GoldenFile &g, const GoldenFrame &f);
+
+    bool gld_next(GoldenFile &g, uint64_t &hash);
+
+    bool gld_load(GoldenFile &g, const std::string &file_name);
+
+    bool gld_save(const GoldenFile &g, const std::string &file_name);
+
+    bool gld_load_inputs(std::vector<uint32_t> &masks, const std::string &file_name);
+
+    bool gld_write_diff(const std::string &file_name, const GoldenFrame &expected, const GoldenFrame &actual);
+}
@@ -1,6 +1,9 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
+#include <bitset>
+
 namespace t8::core
 {
     struct VirtualMemory
@@ -20,7 +23,56 @@ namespace t8::core
 
         uint8_t view_clip[4];
         int8_t draw_offset[2];
+        uint8_t draw_target;
 
         uint32_t cache[256];
     };
-}
\ No newline at end of file
+
+    // 脚本可见的平坦地址空间, 即 VirtualMemory 的字节布局
+    // 除 [ADDR_VIEW_CLIP, ADDR_CACHE) 的绘制状态外都可以写入; 绘制状态对 mem_* 只读
+    constexpr uint32_t ADDR_SCREEN = offsetof(VirtualMemory, screen);
+    constexpr uint32_t ADDR_SPRITE = offsetof(VirtualMemory, sprite);
+    constexpr uint32_t ADDR_MAP = offsetof(VirtualMemory, map);
+    constexpr uint32_t ADDR_PALETTE = offsetof(VirtualMemory, palette);
+    constexpr uint32_t ADDR_PALETTE_MAPPING = offsetof(VirtualMemory, palette_mapping);
+    constexpr uint32_t ADDR_PALETTE_MASK = offsetof(VirtualMemory, palette_mask);
+    constexpr uint32_t ADDR_FLAGS = offsetof(VirtualMemory, flags);
+    constexpr uint32_t ADDR_DEFAULT_FONT = offsetof(VirtualMemory, default_font);
+    constexpr uint32_t ADDR_CUSTOM_FONT = offsetof(VirtualMemory, custom_font);
+    constexpr uint32_t ADDR_VIEW_CLIP = offsetof(VirtualMemory, view_clip);
+    constexpr uint32_t ADDR_DRAW_OFFSET = offsetof(VirtualMemory, draw_offset);
+    constexpr uint32_t ADDR_DRAW_TARGET = offsetof(VirtualMemory, draw_target);
+    constexpr uint32_t ADDR_CACHE = offsetof(VirtualMemory, cache);
+    constexpr uint32_t ADDR_END = sizeof(VirtualMemory);
+
+    uint8_t mem_peek(const VirtualMemory *m, uint32_t addr);
+
+    void mem_poke(VirtualMemory *m, uint32_t addr, uint8_t value);
+
+    uint32_t mem_peek4(const VirtualMemory *m, uint32_t addr);
+
+    void mem_poke4(VirtualMemory *m, uint32_t addr, uint32_t value);
+
+    void mem_copy(VirtualMemory *m, uint32_t dst, uint32_t src, uint32_t size);
+
+    void mem_set(VirtualMemory *m, uint32_t dst, uint8_t value, uint32_t size);
+
+    // 绕过 mem_* 整块改写内存后调用, 使覆盖到的缓存与索引失效, 并记录写入的页
+    void mem_touch(VirtualMemory *m, uint32_t addr, uint32_t size);
+
+    // 按 256 字节分页记录写入, 用于 base_memory 与 exec_memory 之间只复制变化的页
+    constexpr uint32_t MEM_PAGE_SHIFT = 8;
+    constexpr uint32_t MEM_PAGE_SIZE = 1 << MEM_PAGE_SHIFT;
+    constexpr uint32_t MEM_PAGE_COUNT = (ADDR_END + MEM_PAGE_SIZE - 1) >> MEM_PAGE_SHIFT;
+
+    using PageSet = std::bitset<MEM_PAGE_COUNT>;
+
+    // 之后对 m 的写入记录到 pages 中; pages 为 nullptr 时停止记录. 同时至多记录两块内存
+    void mem_track(const VirtualMemory *m, PageSet *pages);
+
+    // 写入路径调用: 标记 [addr, addr + size) 覆盖的页, m 未被记录时忽略
+    void mem_mark(const VirtualMemory *m, uint32_t addr, uint32_t size);
+
+    // 同上, 以指针给出写入的区域; 不在 m 之内 (如额外绘制表面) 时忽略
+    void mem_mark(const VirtualMemory *m, const void *p, size_t size);
+}
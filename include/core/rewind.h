@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace t8::core {
+    struct VirtualMemory;
+}
+
+namespace t8::core {
+    struct RewindFrame {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    // 每帧保存与上一帧的 XOR 差分 (零段游程压缩), 环形存放于 arena 中
+    // latest 为最新一帧的完整快照, 回退时逐帧异或还原
+    // 相邻帧的差异集中在少数几段, 只压缩零段已足够, 不再叠加 LZ
+    struct RewindState {
+        // 由 --rewind 开启, 只记录运行中的脚本
+        // 快照只覆盖 VirtualMemory, Lua 中的变量不回退; 回退期间显示快照中的屏幕而不调用 draw
+        bool enabled = false;
+
+        std::vector<uint8_t> arena;
+        std::vector<uint8_t> scratch;
+        std::vector<uint8_t> latest;
+        bool has_latest = false;
+
+        std::vector<RewindFrame> frames;
+        size_t head = 0;
+        size_t count = 0;
+        size_t write = 0;
+
+        uint64_t encode_us = 0;
+        uint64_t encode_us_max = 0;
+        uint64_t encode_us_total = 0;
+        uint64_t pushes = 0;
+    };
+
+    bool rwd_init(RewindState &s, size_t arena_bytes = 4 << 20, size_t max_frames = 4096);
+
+    void rwd_reset(RewindState &s);
+
+    void rwd_push(RewindState &s, const VirtualMemory *m);
+
+    bool rwd_step(RewindState &s, VirtualMemory *m);
+
+    size_t rwd_frames(const RewindState &s);
+
+    size_t rwd_bytes(const RewindState &s);
+}
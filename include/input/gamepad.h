@@ -33,6 +33,8 @@ namespace t8::input
 
     void g_button(GamepadState &s, uint32_t id, uint8_t btn, bool down);
 
+    void g_set(GamepadState &s, uint8_t i, uint8_t btn);
+
     bool g_down(const GamepadState &s, uint8_t i, uint8_t btn);
 
     bool g_pressed(const GamepadState &s, uint8_t i, uint8_t btn);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "input/gamepad.h"
+#include "input/keyboard.h"
+#include "input/mouse.h"
+
+namespace t8::input
+{
+    enum class ReplayMode
+    {
+        Idle,
+        Recording,
+        Replaying
+    };
+
+    // 以逻辑 tick 为单位记录输入状态, 仅写入发生变化的字段
+    struct InputRecorder
+    {
+        ReplayMode mode{ReplayMode::Idle};
+
+        // 录制时的随机数种子, 写在流的头部, 回放时以同一种子运行脚本
+        uint64_t seed{0};
+
+        std::vector<uint8_t> stream;
+        size_t cursor{0};
+
+        uint64_t tick{0};
+        uint64_t last_tick{0};
+        uint64_t next_tick{0};
+
+        uint8_t gamepad[4]{0};
+        uint8_t keyboard[32]{0};
+        uint8_t mod{0};
+        int16_t mouse_x{0}, mouse_y{0};
+        uint8_t mouse_button{0};
+
+        // 本 tick 待写入的文本, 已按 [varint 长度][字节] 编码, 共 text_count 段
+        std::vector<uint8_t> texts;
+        uint32_t text_count{0};
+
+        // 每 tick 复用的编码缓冲
+        std::vector<uint8_t> body;
+    };
+
+    using ReplayTextFn = std::function<void(std::string_view)>;
+
+    void rec_start(InputRecorder &r, uint64_t seed);
+
+    void rec_stop(InputRecorder &r);
+
+    bool rec_replay(InputRecorder &r, const std::vector<uint8_t> &stream);
+
+    bool rec_replaying(const InputRecorder &r);
+
+    void rec_text(InputRecorder &r, std::string_view text);
+
+    void rec_tick(InputRecorder &r, GamepadState &g, KeyboardState &k, MouseState &m, const ReplayTextFn &on_text);
+
+    bool rec_save(const InputRecorder &r, const std::string &file_name);
+
+    bool rec_load(std::vector<uint8_t> &stream, const std::string &file_name);
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "utils/ring_queue.hpp"
+
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -28,13 +31,16 @@ namespace t8::scene::console
         bool use = false;
     };
 
+    // 控制台只保留最近的记录, 更早的被丢弃
+    constexpr size_t CONSOLE_RECORDS = 128;
+
     struct ConsoleState
     {
         std::vector<std::string> history;
         size_t history_index = 0;
         bool use_history = false;
 
-        std::vector<ConsoleRecord> records;
+        t8::utils::RingQueue<ConsoleRecord, CONSOLE_RECORDS> records;
         std::string input;
         size_t cursor = 0;
 
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace t8::core
+{
+    struct AppContext;
+}
+
+namespace t8::scene::executor
+{
+    using namespace t8::core;
+
+    void update(AppContext &ctx);
+
+    void draw(AppContext &ctx);
+
+    void enter(AppContext &ctx);
+
+    void leave(AppContext &ctx);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace t8::script {
+    // 预编译字节码: ["T8BC"][u32 Lua 版本][u64 源码哈希][lua_dump 输出 (去除调试信息)]
+    uint64_t chunk_hash(std::string_view source);
+
+    bool chunk_compile(std::string_view source, std::vector<uint8_t> &out, std::string &error, bool strip = true);
+
+    // 仅当版本与源码哈希都一致时字节码才可用
+    bool chunk_matches(const std::vector<uint8_t> &bytecode, std::string_view source);
+
+    std::string_view chunk_code(const std::vector<uint8_t> &bytecode);
+}
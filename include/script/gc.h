@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string_view>
+
+struct lua_State;
+
+namespace t8::script {
+    enum class GcMode : uint8_t {
+        Incremental,
+        Generational,
+    };
+
+    // 参数为 0 时保持 Lua 的默认值
+    struct GcProfile {
+        GcMode mode;
+        int pause;
+        int stepmul;
+        int stepsize;
+        int minormul;
+        int majormul;
+        // 每帧 draw 之后用于主动回收的时间预算
+        uint32_t budget_us;
+    };
+
+    constexpr GcProfile GC_GENERATIONAL{GcMode::Generational, 0, 0, 0, 20, 100, 1000};
+    // 自动回收几乎不触发, 主要依靠每帧的空闲步进, 暂停最短
+    constexpr GcProfile GC_SMOOTH{GcMode::Incremental, 400, 100, 10, 0, 0, 2000};
+    // 少做增量步进, 适合短时间内大量分配的卡带
+    constexpr GcProfile GC_THROUGHPUT{GcMode::Incremental, 200, 400, 13, 0, 0, 500};
+
+    struct GcStats {
+        uint64_t step_us = 0;
+        uint64_t step_us_max = 0;
+        uint32_t steps = 0;
+        uint32_t cycles = 0;
+        size_t heap_bytes = 0;
+    };
+
+    bool gc_profile(std::string_view name, GcProfile &profile);
+
+    void gc_apply(lua_State *L, const GcProfile &profile);
+
+    // 在预算内反复步进, 完成一轮回收后提前结束
+    void gc_idle(lua_State *L, const GcProfile &profile, GcStats &stats);
+
+    size_t gc_heap_bytes(lua_State *L);
+}
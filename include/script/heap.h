@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+namespace t8::script {
+    // 小于等于 256 字节按 16 字节分级, 其后至 1024 字节按 64 字节分级, 更大的块直接向系统申请
+    constexpr size_t HEAP_SMALL_MAX = 1024;
+    constexpr size_t HEAP_CLASS_COUNT = 16 + 12;
+    constexpr size_t HEAP_ARENA_SIZE = 256 << 10;
+    constexpr size_t HEAP_DEFAULT_LIMIT = 64 << 20;
+
+    struct HeapStats {
+        size_t live = 0;
+        size_t peak = 0;
+        uint64_t allocs = 0;
+        uint64_t frees = 0;
+        // 自上次 heap_frame 以来的计数
+        uint64_t frame_allocs = 0;
+        uint64_t frame_frees = 0;
+        uint64_t refused = 0;
+    };
+
+    // 脚本 VM 专用的分级空闲链表分配器, 小块从大块 arena 中切分
+    // 超过 limit 的申请返回空指针, 由 Lua 抛出内存不足错误
+    // VM 在多次运行之间常驻, 每次运行结束后的垃圾经 GC 回到空闲链表供下次复用;
+    // arena 只在 VM 关闭 (进程退出) 时随 ScriptHeap 整体释放
+    struct ScriptHeap {
+        size_t limit = HEAP_DEFAULT_LIMIT;
+
+        std::vector<std::unique_ptr<uint8_t[]>> arenas;
+        uint8_t *cursor = nullptr;
+        uint8_t *end = nullptr;
+        void *free_lists[HEAP_CLASS_COUNT]{};
+        // 内存不足时由大块收缩而来的小块仍由 malloc 持有, 释放时按地址识别并交还系统
+        size_t strays = 0;
+
+        HeapStats stats;
+    };
+
+    // 签名与 lua_Alloc 一致, ud 为 ScriptHeap
+    void *heap_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    void heap_frame(ScriptHeap &h);
+
+    size_t heap_reserved(const ScriptHeap &h);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+struct lua_State;
+
+namespace t8::script {
+    // 查表的精度: 一圈分为 4096 份, 表项之间线性插值
+    constexpr int MATH_TABLE_SIZE = 4096;
+
+    // 角度以圈为单位 (1 = 360°); 与屏幕 y 轴向下一致, sin 取反
+    float math_sin(float turns);
+
+    float math_cos(float turns);
+
+    // 返回 [0, 1) 的圈数, atan2(1, 0) = 0, atan2(0, -1) = 0.25
+    float math_atan2(float dx, float dy);
+
+    // 注册为 t8math 模块, 全部为原生 lua_CFunction
+    int luaopen_t8math(lua_State *L);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "utils/fixed_string.hpp"
+
+struct lua_State;
+
+namespace t8::script {
+    constexpr size_t PROF_MAX_DEPTH = 24;
+    constexpr size_t PROF_MAX_FUNCS = 1024;
+    constexpr size_t PROF_SLOT_COUNT = PROF_MAX_FUNCS * 2;
+    constexpr size_t PROF_RING_SIZE = 1 << 16;
+    constexpr int PROF_DEFAULT_INTERVAL = 1000;
+
+    using ProfLabel = utils::FixedString<63>;
+
+    struct ProfFunc {
+        const void *source;
+        const void *name;
+        int line;
+        ProfLabel label;
+    };
+
+    // frames[0] 为最内层函数
+    struct ProfSample {
+        uint8_t depth;
+        uint16_t frames[PROF_MAX_DEPTH];
+    };
+
+    // 由计数钩子每 interval 条指令采样一次调用栈, 样本存放在预分配的环形缓冲中
+    struct Profiler {
+        bool running = false;
+        int interval = PROF_DEFAULT_INTERVAL;
+
+        std::vector<ProfFunc> funcs;
+        uint16_t slots[PROF_SLOT_COUNT]{};
+        std::vector<ProfSample> samples;
+        size_t head = 0;
+        size_t count = 0;
+        uint64_t total = 0;
+    };
+
+    struct ProfEntry {
+        const ProfFunc *func;
+        uint64_t self;
+        uint64_t inclusive;
+    };
+
+    void prof_start(Profiler &p, int interval = PROF_DEFAULT_INTERVAL);
+
+    void prof_stop(Profiler &p);
+
+    // 在钩子中调用, 不做堆分配 (首次遇到的函数除外)
+    void prof_sample(Profiler &p, lua_State *L);
+
+    // 每行 "root;...;leaf count", 可直接交给 flamegraph.pl 等工具
+    std::string prof_folded(const Profiler &p);
+
+    bool prof_save(const Profiler &p, const std::string &file_name);
+
+    // 按自身耗时 (作为最内层函数的样本数) 降序
+    std::vector<ProfEntry> prof_top(const Profiler &p, size_t n);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+struct lua_State;
+
+namespace t8::script {
+    struct ReloadResult {
+        bool ok = false;
+        std::string source;
+        std::vector<uint8_t> bytecode;
+        std::string error;
+    };
+
+    // 在后台线程中编译源码 (保留调试信息, 用于按名字匹配上值)
+    std::future<ReloadResult> rld_compile(std::string source);
+
+    // 在暂存环境中执行新代码块, 再将其中的函数换入 env (栈索引) 所指的运行中环境:
+    // - 同名函数的上值若在旧函数中存在且不是函数, 则与旧上值合并, 保留文件级局部变量的状态
+    // - 已存在的非函数全局保持不变, 新出现的全局直接加入
+    // - 两边都是表时递归一层, 以更新 Player.update 这类模块函数
+    bool rld_apply(lua_State *L, int env, const std::vector<uint8_t> &bytecode, std::string &error);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+struct lua_State;
+
+namespace t8::script {
+    // 等待中的任务, 以注册表引用持有协程 (spawn / after) 或周期回调 (every)
+    struct SchedTask {
+        uint64_t wake;
+        // 同一 tick 内按加入顺序唤醒
+        uint64_t seq;
+        int ref;
+        // every 的间隔, 协程任务为 0
+        uint32_t period;
+    };
+
+    // 按唤醒 tick 排列的最小堆, 每 tick 只访问到期的任务
+    struct Scheduler {
+        std::vector<SchedTask> heap;
+        uint64_t tick = 0;
+        uint64_t seq = 0;
+        // 最近一次 sch_run 唤醒的任务数
+        uint32_t resumed = 0;
+    };
+
+    // 以下为 lua_CFunction 的实现, 参数位于 L 的栈上
+
+    // spawn(fn): 以 fn 创建协程, 在本 tick 的 sch_run 中开始执行
+    int sch_spawn(lua_State *L, Scheduler &s);
+
+    // after(n, fn): n tick 后以协程执行 fn
+    int sch_after(lua_State *L, Scheduler &s);
+
+    // every(n, fn): 每 n tick 调用一次 fn, fn 返回 false 时停止
+    int sch_every(lua_State *L, Scheduler &s);
+
+    // wait(n = 1): 挂起当前协程 n tick, 只能在 spawn / after 的协程中调用
+    int sch_wait(lua_State *L);
+
+    // 唤醒到期的任务后推进一 tick; 任务出错时返回 false 并写入带调用栈的错误
+    bool sch_run(lua_State *L, Scheduler &s, std::string &error);
+
+    // 释放全部任务并将 tick 归零
+    void sch_clear(lua_State *L, Scheduler &s);
+
+    size_t sch_pending(const Scheduler &s);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+
+#include <chrono>
+
+namespace t8::script {
+    // 钩子每隔多少条指令检查一次
+    constexpr int WD_INTERVAL = 10000;
+
+    // 限制单次回调 (init/update/draw) 的执行时间与指令数, 为 0 表示不限
+    struct Watchdog {
+        uint32_t budget_ms = 1000;
+        uint64_t budget_instructions = 0;
+
+        bool armed = false;
+        const char *callback = nullptr;
+        uint64_t executed = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void wd_arm(Watchdog &w, const char *callback);
+
+    void wd_disarm(Watchdog &w);
+
+    // 累计 instructions 条指令, 超出预算时返回 true
+    bool wd_check(Watchdog &w, int instructions);
+}
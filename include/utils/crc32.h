@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace t8::utils {
+    // zip 与 png 共用的 CRC-32 (多项式 0xEDB88320), crc 为之前数据的结果, 可分段计算
+    uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace t8::utils {
+    // 编码格式: 重复 [varint 相同字节数][varint 差异字节数][差异字节 XOR 值]
+    size_t delta_bound(size_t n);
+
+    size_t delta_encode(uint8_t *out, const uint8_t *cur, const uint8_t *prev, size_t n);
+
+    bool delta_apply(uint8_t *dst, const uint8_t *in, size_t size, size_t n);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace t8::utils {
+
+    // 定长内联字符串, 不做堆分配; 超出容量时在 UTF-8 字符边界截断并以 "..." 结尾
+    template <size_t N>
+    class FixedString {
+    private:
+        char _data[N + 1]{0};
+        size_t _size = 0;
+
+    public:
+        FixedString() = default;
+
+        FixedString(std::string_view s) {
+            assign(s);
+        }
+
+        FixedString(const std::string &s) {
+            assign(s);
+        }
+
+        FixedString(const char *s) {
+            assign(s ? std::string_view(s) : std::string_view());
+        }
+
+        void assign(std::string_view s) {
+            if (s.size() <= N) {
+                _size = s.size();
+                std::memcpy(_data, s.data(), _size);
+                _data[_size] = 0;
+                return;
+            }
+
+            constexpr std::string_view ellipsis = "...";
+            auto n = N > ellipsis.size() ? N - ellipsis.size() : 0;
+            while (n > 0 && (s[n] & 0xC0) == 0x80)
+                n -= 1;
+
+            std::memcpy(_data, s.data(), n);
+            const auto tail = std::min(ellipsis.size(), N - n);
+            std::memcpy(_data + n, ellipsis.data(), tail);
+            _size = n + tail;
+            _data[_size] = 0;
+        }
+
+        void clear() {
+            _size = 0;
+            _data[0] = 0;
+        }
+
+        std::string_view view() const { return {_data, _size}; }
+        const char *c_str() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        const char *begin() const { return _data; }
+        const char *end() const { return _data + _size; }
+
+        static constexpr size_t capacity() { return N; }
+    };
+
+}
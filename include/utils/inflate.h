@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace t8::utils {
+    // 解压 raw deflate (RFC 1951) 数据, 至多写入 cap 字节, 写满后停止解压
+    // 数据损坏时返回 false, written 为已写入的字节数
+    bool inflate(uint8_t *dst, size_t cap, const uint8_t *src, size_t size, size_t &written);
+}
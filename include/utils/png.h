@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace t8::utils {
+    // 写出未压缩 (stored deflate) 的 RGBA PNG, 像素格式与 RGBA() 宏一致
+    bool png_write(const std::string &file_name, const uint32_t *pixels, uint32_t width, uint32_t height);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace t8::utils {
+
+    // 定容环形队列, 队满时丢弃新元素并计数
+    template <typename T, size_t N>
+    class RingQueue {
+        static_assert(N > 0 && (N & (N - 1)) == 0, "RingQueue capacity must be a power of two");
+
+    private:
+        T _items[N]{};
+        size_t _head = 0;
+        size_t _tail = 0;
+        uint64_t _dropped = 0;
+
+    public:
+        bool push(const T &item) {
+            if (full()) {
+                _dropped += 1;
+                return false;
+            }
+            _items[_tail++ & (N - 1)] = item;
+            return true;
+        }
+
+        bool push(T &&item) {
+            if (full()) {
+                _dropped += 1;
+                return false;
+            }
+            _items[_tail++ & (N - 1)] = std::move(item);
+            return true;
+        }
+
+        T &front() { return _items[_head & (N - 1)]; }
+        const T &front() const { return _items[_head & (N - 1)]; }
+
+        // 从队首起的第 i 个元素
+        T &operator[](size_t i) { return _items[(_head + i) & (N - 1)]; }
+        const T &operator[](size_t i) const { return _items[(_head + i) & (N - 1)]; }
+
+        void pop() {
+            if (!empty())
+                _head += 1;
+        }
+
+        void clear() {
+            _head = _tail = 0;
+        }
+
+        bool empty() const { return _head == _tail; }
+        bool full() const { return _tail - _head == N; }
+        size_t size() const { return _tail - _head; }
+
+        uint64_t dropped() const { return _dropped; }
+        void reset_dropped() { _dropped = 0; }
+
+        static constexpr size_t capacity() { return N; }
+    };
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace t8::utils {
+
+    // LEB128 无符号变长整数, 返回写入/读取的字节数
+    inline size_t varint_write(uint8_t *p, uint64_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        return n;
+    }
+
+    inline size_t varint_read(const uint8_t *p, const uint8_t *end, uint64_t &v) {
+        v = 0;
+        size_t n = 0;
+        for (auto shift = 0; p + n < end && shift < 64; shift += 7) {
+            const auto b = p[n++];
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return n;
+        }
+        return 0;
+    }
+
+    constexpr size_t VARINT_MAX_BYTES = 10;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace t8::utils {
+    enum ZipMethod : uint16_t {
+        ZIP_STORED = 0,
+        ZIP_DEFLATED = 8,
+    };
+
+    // 条目的名字与数据直接指向映射区, 不做复制
+    struct ZipEntry {
+        std::string_view name;
+        uint16_t method;
+        const uint8_t *data;
+        size_t compressed_size;
+        size_t size;
+        uint32_t crc;
+    };
+
+    // 以只读方式映射整个 zip 文件, 只读取中央目录; 不支持 zip64 与加密
+    struct ZipArchive {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        std::vector<ZipEntry> entries;
+
+        ZipArchive() = default;
+        ZipArchive(const ZipArchive &) = delete;
+        ZipArchive &operator=(const ZipArchive &) = delete;
+        ~ZipArchive();
+    };
+
+    bool zip_open(ZipArchive &zip, const std::string &file_name);
+
+    void zip_close(ZipArchive &zip);
+
+    const ZipEntry *zip_find(const ZipArchive &zip, std::string_view name);
+
+    // 解压到 dst, 写入的字节数必须与头部记录的大小一致; cap 不足, 数据损坏,
+    // 大小或 CRC-32 不符时返回 false, 此时 dst 中可能已写入部分数据
+    bool zip_extract(const ZipEntry &entry, uint8_t *dst, size_t cap, size_t &written);
+
+    // 在内存中组装 zip, 条目全部以 stored 方式写入; 卡带只有几十 KB, 不做压缩
+    struct ZipWriter {
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> directory;
+        uint16_t count = 0;
+    };
+
+    void zip_add(ZipWriter &zip, std::string_view name, const uint8_t *data, size_t size);
+
+    bool zip_save(const ZipWriter &zip, const std::string &file_name);
+}
@@ -1,20 +1,84 @@
 
 #include <iostream>
 #include <memory>
+#include <random>
+#include <string>
 
 #include "core/emulator.h"
+#include "input/replay.h"
 
 using namespace t8::core;
+using namespace t8::input;
 
 int main(int argc, char *argv[])
 {
     auto ctx = std::make_unique<AppContext>();
 
+    std::string record_file;
+    std::string verify_cart, verify_input, verify_golden;
+    bool update_golden = false;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--single-thread")
+        {
+            ctx->threaded = false;
+        }
+        else if (arg == "--bytecode")
+        {
+            ctx->load_bytecode = true;
+        }
+        else if (arg == "--rewind")
+        {
+            ctx->rewind.enabled = true;
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            record_file = argv[++i];
+            // 录制与回放都以确定的方式运行脚本, 种子随录制保存
+            ctx->deterministic = true;
+            ctx->seed = std::random_device{}();
+            rec_start(ctx->recorder, ctx->seed);
+        }
+        else if ((arg == "--verify" || arg == "--update-golden") && i + 3 < argc)
+        {
+            update_golden = arg == "--update-golden";
+            verify_cart = argv[++i];
+            verify_input = argv[++i];
+            verify_golden = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            std::vector<uint8_t> stream;
+            if (!rec_load(stream, argv[++i]) || !rec_replay(ctx->recorder, stream))
+            {
+                std::cerr << "Failed to load replay " << argv[i] << std::endl;
+                return 1;
+            }
+            ctx->deterministic = true;
+            ctx->seed = ctx->recorder.seed;
+        }
+    }
+
+    if (!verify_golden.empty())
+    {
+        return emu_verify(ctx.get(), verify_cart, verify_input, verify_golden, update_golden);
+    }
+
     if (emu_init(ctx.get()))
     {
         emu_run(ctx.get());
         emu_quit(ctx.get());
     }
 
+    if (!record_file.empty())
+    {
+        rec_stop(ctx->recorder);
+        if (!rec_save(ctx->recorder, record_file))
+            std::cerr << "Failed to save recording " << record_file << std::endl;
+    }
+
     return 0;
 }
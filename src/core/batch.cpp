@@ -0,0 +1,233 @@
+#include "core/batch.h"
+#include "core/gfx.h"
+#include "core/memory.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace t8::core {
+    static inline uint16_t state_key(const DrawCmd &cmd) {
+        return static_cast<uint16_t>((cmd.op << 8) | cmd.color);
+    }
+
+    // 一次批量绘制中不变的状态: 裁剪边界、偏移、透明掩码与目标表面
+    struct DrawState {
+        int l, t, r, b;
+        int ox, oy;
+        uint16_t mask;
+        uint8_t *surface;
+    };
+
+    // 裁剪边界收紧到 128x128 的表面之内, 之后 plot 无需再检查坐标
+    static DrawState draw_state(VirtualMemory *m) {
+        auto surface = gfx_surface(m, m->draw_target);
+        const auto l = std::min<int>(m->view_clip[0], 127);
+        const auto t = std::min<int>(m->view_clip[1], 127);
+        return {
+            l,
+            t,
+            std::min(l + m->view_clip[2], 128),
+            std::min(t + m->view_clip[3], 128),
+            m->draw_offset[0],
+            m->draw_offset[1],
+            m->palette_mask,
+            surface ? surface : m->screen,
+        };
+    }
+
+    // 只按裁剪区域覆盖的行记录写入的页, 不逐点记录
+    static inline void mark(VirtualMemory *m, const DrawState &s) {
+        if (s.b > s.t)
+            mem_mark(m, s.surface + (s.t << 6), static_cast<size_t>(s.b - s.t) << 6);
+    }
+
+    static inline bool clipped(const DrawState &s, int x, int y) {
+        return x < s.l || y < s.t || x >= s.r || y >= s.b;
+    }
+
+    static inline bool transparent(const DrawState &s, int c) {
+        return c < 16 && (s.mask & (1 << c));
+    }
+
+    // x, y 为已偏移并通过裁剪的坐标
+    static inline void plot(const DrawState &s, int x, int y, uint8_t c) {
+        auto &p = s.surface[(y << 6) | (x >> 1)];
+        p = (x & 1) ? ((p & 0x0F) | (c << 4)) : ((p & 0xF0) | c);
+    }
+
+    // 同色的连续点共享裁剪、偏移、透明与目标表面的计算
+    static void draw_points(VirtualMemory *m, const DrawCmd *cmds, size_t n) {
+        const auto s = draw_state(m);
+        if (transparent(s, cmds[0].color))
+            return;
+
+        const auto color = cmds[0].color & 0xF;
+        for (size_t i = 0; i < n; i++) {
+            const auto x = cmds[i].a + s.ox;
+            const auto y = cmds[i].b + s.oy;
+            if (!clipped(s, x, y))
+                plot(s, x, y, color);
+        }
+        mark(m, s);
+    }
+
+    static void draw_run(VirtualMemory *m, const DrawCmd *cmds, size_t n) {
+        if (cmds[0].op == DRAW_PSET) {
+            draw_points(m, cmds, n);
+            return;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const auto &cmd = cmds[i];
+            switch (cmd.op) {
+            case DRAW_LINE:
+                gfx_line(m, cmd.a, cmd.b, cmd.c, cmd.d, cmd.color);
+                break;
+            case DRAW_RECT:
+            case DRAW_RECTFILL:
+                gfx_rect(m, cmd.a, cmd.b, cmd.c, cmd.d, cmd.color, cmd.op == DRAW_RECTFILL);
+                break;
+            case DRAW_CIRC:
+            case DRAW_CIRCFILL:
+                gfx_circ(m, cmd.a, cmd.b, cmd.c, cmd.color, cmd.op == DRAW_CIRCFILL);
+                break;
+            case DRAW_SPR:
+                gfx_spr(m, cmd.color, cmd.a, cmd.b, cmd.c, static_cast<uint8_t>(cmd.d));
+                break;
+            case DRAW_CHAR:
+                gfx_char(m, static_cast<uint8_t>(cmd.c), cmd.a, cmd.b, cmd.color, cmd.d != 0);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // 按状态键做稳定的计数排序, 同一状态内保持提交顺序
+    static void sort_by_state(DrawBatch &batch) {
+        static uint32_t offsets[(DRAW_CHAR + 1) << 8];
+        std::fill(std::begin(offsets), std::end(offsets), 0);
+
+        for (const auto &cmd : batch.cmds)
+            offsets[state_key(cmd)] += 1;
+
+        uint32_t total = 0;
+        for (auto &offset : offsets) {
+            const auto count = offset;
+            offset = total;
+            total += count;
+        }
+
+        batch.scratch.resize(batch.cmds.size());
+        for (const auto &cmd : batch.cmds)
+            batch.scratch[offsets[state_key(cmd)]++] = cmd;
+        batch.cmds.swap(batch.scratch);
+    }
+
+    void bat_points(VirtualMemory *m, const int16_t *xyc, size_t count) {
+        const auto s = draw_state(m);
+        for (size_t i = 0; i < count; i++, xyc += 3) {
+            const auto x = xyc[0] + s.ox;
+            const auto y = xyc[1] + s.oy;
+            const auto c = static_cast<uint8_t>(xyc[2]);
+            if (!clipped(s, x, y) && !transparent(s, c))
+                plot(s, x, y, c & 0xF);
+        }
+        mark(m, s);
+    }
+
+    void bat_sprites(VirtualMemory *m, const int16_t *quads, size_t count) {
+        const auto s = draw_state(m);
+        for (size_t i = 0; i < count; i++, quads += 4) {
+            const auto n = static_cast<uint8_t>(quads[0]);
+            const auto x = quads[1] + s.ox;
+            const auto y = quads[2] + s.oy;
+            const auto flags = quads[3];
+            if (x + 8 <= s.l || y + 8 <= s.t || x >= s.r || y >= s.b)
+                continue;
+
+            const auto sprite_x = (n & 0xF) << 3;
+            const auto sprite_y = (n >> 4) << 3;
+
+            for (auto dy = 0; dy < 8; dy++) {
+                const auto py = y + dy;
+                if (py < s.t || py >= s.b)
+                    continue;
+
+                for (auto dx = 0; dx < 8; dx++) {
+                    const auto px = x + dx;
+                    if (px < s.l || px >= s.r)
+                        continue;
+
+                    // 翻转与旋转同 gfx_spr
+                    auto tx = (flags & 0b1) ? 7 - dx : dx;
+                    auto ty = (flags & 0b10) ? 7 - dy : dy;
+                    if (flags & 0b100) {
+                        const auto t = tx;
+                        tx = ty;
+                        ty = 7 - t;
+                    }
+                    if (flags & 0b1000) {
+                        tx = 7 - tx;
+                        ty = 7 - ty;
+                    }
+
+                    const auto sx = sprite_x + tx;
+                    const auto sp = m->sprite[((sprite_y + ty) << 6) | (sx >> 1)];
+                    const auto c = (sx & 1) ? (sp >> 4) : (sp & 0xF);
+                    if (!transparent(s, c))
+                        plot(s, px, py, c);
+                }
+            }
+        }
+        mark(m, s);
+    }
+
+    void bat_push(DrawBatch &batch, uint8_t op, uint8_t color, int a, int b, int c, int d) {
+        if (op > DRAW_CHAR)
+            return;
+        batch.cmds.push_back({
+            op,
+            color,
+            static_cast<int16_t>(a),
+            static_cast<int16_t>(b),
+            static_cast<int16_t>(c),
+            static_cast<int16_t>(d),
+        });
+    }
+
+    void bat_text(DrawBatch &batch, std::string_view s, int x, int y, uint8_t color, int w0, int w1) {
+        const auto sx = x;
+        for (auto ch : s) {
+            if (ch == '\n') {
+                y += 8;
+                x = sx;
+            } else if (ch != '\r') {
+                bat_push(batch, DRAW_CHAR, color, x, y, static_cast<uint8_t>(ch), 1);
+                x += (static_cast<uint8_t>(ch) < 0x80) ? w0 : w1;
+            }
+        }
+    }
+
+    void bat_clear(DrawBatch &batch) {
+        batch.cmds.clear();
+    }
+
+    size_t bat_flush(VirtualMemory *m, DrawBatch &batch) {
+        if (!batch.ordered)
+            sort_by_state(batch);
+
+        auto &cmds = batch.cmds;
+        const auto n = cmds.size();
+        for (size_t i = 0; i < n;) {
+            auto j = i + 1;
+            while (j < n && state_key(cmds[j]) == state_key(cmds[i]))
+                j++;
+            draw_run(m, cmds.data() + i, j - i);
+            i = j;
+        }
+
+        cmds.clear();
+        return n;
+    }
+}
@@ -0,0 +1,116 @@
+#include "core/cart.h"
+#include "core/context.h"
+#include "core/memory.h"
+#include "script/chunk.h"
+#include "utils/zip.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace t8::script;
+using namespace t8::utils;
+
+namespace t8::core {
+    static bool load_script(AppContext &ctx, const std::string &file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+
+        ctx.script.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        ctx.bytecode.clear();
+        ctx.script_path = file_name;
+        return true;
+    }
+
+    bool cart_load(AppContext &ctx, const std::string &file_name) {
+        if (file_name.ends_with(".lua"))
+            return load_script(ctx, file_name);
+
+        ZipArchive zip;
+        if (!zip_open(zip, file_name))
+            return false;
+
+        // 脚本先解压到独立的缓冲, 资源解压失败时当前卡带保持不变
+        std::string script;
+        if (const auto entry = zip_find(zip, "script.lua")) {
+            script.resize(entry->size);
+            size_t written;
+            if (!zip_extract(*entry, reinterpret_cast<uint8_t *>(script.data()), script.size(), written))
+                return false;
+            script.resize(written);
+        }
+
+        std::vector<uint8_t> bytecode;
+        if (const auto entry = zip_find(zip, "script.luac")) {
+            bytecode.resize(entry->size);
+            size_t written;
+            if (!zip_extract(*entry, bytecode.data(), bytecode.size(), written))
+                return false;
+            bytecode.resize(written);
+        }
+
+        // 资源直接解压到虚拟内存对应的区域, 大于区域的条目视为损坏;
+        // 卡带中缺少的区域保持原样. 解压前整体备份一次, 失败时据此还原
+        const auto m = ctx.memory;
+        const struct {
+            const char *name;
+            uint8_t *dst;
+            size_t size;
+        } sections[] = {
+            {"font", m->custom_font, sizeof(VirtualMemory::custom_font)},
+            {"map", m->map, sizeof(VirtualMemory::map)},
+            {"sprite", m->sprite, sizeof(VirtualMemory::sprite)},
+        };
+
+        std::vector<uint8_t> backup;
+        for (const auto &section : sections)
+            backup.insert(backup.end(), section.dst, section.dst + section.size);
+
+        for (const auto &section : sections) {
+            const auto entry = zip_find(zip, section.name);
+            size_t written;
+            if (!entry || zip_extract(*entry, section.dst, section.size, written))
+                continue;
+
+            auto from = backup.data();
+            for (const auto &s : sections) {
+                std::memcpy(s.dst, from, s.size);
+                from += s.size;
+            }
+            return false;
+        }
+
+        // 没有 script.lua 的卡带同样替换掉上一个脚本, 不能沿用旧的源码与路径
+        ctx.script = std::move(script);
+        ctx.bytecode = std::move(bytecode);
+        ctx.script_path.clear();
+
+        // 直接写入内存, 需要手动使地图缓存与碰撞索引失效
+        mem_touch(m, 0, ADDR_END);
+        return true;
+    }
+
+    bool cart_save(AppContext &ctx, const std::string &file_name, bool compile, std::string &error) {
+        ZipWriter zip;
+        zip_add(zip, "script.lua", reinterpret_cast<const uint8_t *>(ctx.script.data()), ctx.script.size());
+
+        if (compile) {
+            if (!chunk_compile(ctx.script, ctx.bytecode, error))
+                return false;
+            zip_add(zip, "script.luac", ctx.bytecode.data(), ctx.bytecode.size());
+        }
+
+        const auto m = ctx.memory;
+        zip_add(zip, "font", m->custom_font, sizeof(VirtualMemory::custom_font));
+        zip_add(zip, "map", m->map, sizeof(VirtualMemory::map));
+        zip_add(zip, "sprite", m->sprite, sizeof(VirtualMemory::sprite));
+
+        if (!zip_save(zip, file_name)) {
+            error = "Failed to write " + file_name;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,201 @@
+#include "core/collision.h"
+#include "core/memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace t8::core {
+    // 每个标志位一份 128x128 位图, 同时保存按行与按列的布局以便用整字运算
+    static struct {
+        const VirtualMemory *owner = nullptr;
+        bool valid = false;
+        uint64_t rows[8][128][2];
+        uint64_t cols[8][128][2];
+    } index;
+
+    static void set_tile(int x, int y, uint8_t flags) {
+        for (auto b = 0; b < 8; b++) {
+            auto &row = index.rows[b][y][x >> 6];
+            auto &col = index.cols[b][x][y >> 6];
+            if (flags & (1 << b)) {
+                row |= 1ULL << (x & 63);
+                col |= 1ULL << (y & 63);
+            } else {
+                row &= ~(1ULL << (x & 63));
+                col &= ~(1ULL << (y & 63));
+            }
+        }
+    }
+
+    static void ensure(VirtualMemory *m) {
+        if (index.owner == m && index.valid)
+            return;
+
+        std::memset(index.rows, 0, sizeof(index.rows));
+        std::memset(index.cols, 0, sizeof(index.cols));
+
+        for (auto y = 0; y < 128; y++)
+            for (auto x = 0; x < 128; x++)
+                set_tile(x, y, m->flags[m->map[y * 128 + x]]);
+
+        index.owner = m;
+        index.valid = true;
+    }
+
+    // 合并 mask 选中的标志位, lines 为 rows 或 cols
+    static inline uint64_t bits(uint64_t (&lines)[8][128][2], uint8_t mask, int line, int word) {
+        uint64_t v = 0;
+        for (auto b = 0; b < 8; b++)
+            if (mask & (1 << b))
+                v |= lines[b][line][word];
+        return v;
+    }
+
+    // [lo, hi] 与第 word 个 64 位字相交部分的位掩码
+    static inline uint64_t span(int lo, int hi, int word) {
+        lo = std::max(lo, word * 64);
+        hi = std::min(hi, word * 64 + 63);
+        if (lo > hi)
+            return 0;
+        const auto n = hi - lo + 1;
+        const auto ones = n == 64 ? ~0ULL : ((1ULL << n) - 1);
+        return ones << (lo - word * 64);
+    }
+
+    static bool line_any(uint64_t (&lines)[8][128][2], uint8_t mask, int line, int lo, int hi) {
+        if (line < 0 || line > 127)
+            return false;
+        lo = std::max(lo, 0);
+        hi = std::min(hi, 127);
+        if (lo > hi)
+            return false;
+        return (bits(lines, mask, line, 0) & span(lo, hi, 0)) ||
+               (bits(lines, mask, line, 1) & span(lo, hi, 1));
+    }
+
+    bool col_any(VirtualMemory *m, uint8_t mask, int x, int y, int w, int h) {
+        ensure(m);
+
+        const auto t = std::max(y, 0);
+        const auto b = std::min(y + h, 128);
+        for (auto row = t; row < b; row++) {
+            if (line_any(index.rows, mask, row, x, x + w - 1))
+                return true;
+        }
+        return false;
+    }
+
+    // 返回到第一个匹配格的距离 (起点为 0), 没有则返回 -1
+    int col_ray(VirtualMemory *m, uint8_t mask, int x, int y, uint8_t dir, int max) {
+        ensure(m);
+
+        const auto vertical = dir == RAY_DOWN || dir == RAY_UP;
+        const auto forward = dir == RAY_RIGHT || dir == RAY_DOWN;
+        const auto line = vertical ? x : y;
+        const auto pos = vertical ? y : x;
+        auto &lines = vertical ? index.cols : index.rows;
+
+        if (line < 0 || line > 127 || max <= 0)
+            return -1;
+
+        auto lo = forward ? pos : pos - max + 1;
+        auto hi = forward ? pos + max - 1 : pos;
+        lo = std::max(lo, 0);
+        hi = std::min(hi, 127);
+        if (lo > hi)
+            return -1;
+
+        const uint64_t w[2] = {
+            bits(lines, mask, line, 0) & span(lo, hi, 0),
+            bits(lines, mask, line, 1) & span(lo, hi, 1),
+        };
+
+        if (forward) {
+            for (auto i = 0; i < 2; i++)
+                if (w[i])
+                    return i * 64 + std::countr_zero(w[i]) - pos;
+        } else {
+            for (auto i = 1; i >= 0; i--)
+                if (w[i])
+                    return pos - (i * 64 + 63 - std::countl_zero(w[i]));
+        }
+
+        return -1;
+    }
+
+    SweepResult col_sweep(VirtualMemory *m, uint8_t mask, int x, int y, int w, int h, int dx, int dy) {
+        ensure(m);
+
+        SweepResult r{x, y, false, false};
+        if (w <= 0 || h <= 0)
+            return r;
+
+        // 只检查移动中新进入的格子列
+        const auto t = r.y >> 3, b = (r.y + h - 1) >> 3;
+        if (dx > 0) {
+            const auto from = ((r.x + w - 1) >> 3) + 1, to = (r.x + w - 1 + dx) >> 3;
+            r.x += dx;
+            for (auto c = from; c <= to; c++) {
+                if (line_any(index.cols, mask, c, t, b)) {
+                    r.x = c * 8 - w;
+                    r.hit_x = true;
+                    break;
+                }
+            }
+        } else if (dx < 0) {
+            const auto from = (r.x >> 3) - 1, to = (r.x + dx) >> 3;
+            r.x += dx;
+            for (auto c = from; c >= to; c--) {
+                if (line_any(index.cols, mask, c, t, b)) {
+                    r.x = (c + 1) * 8;
+                    r.hit_x = true;
+                    break;
+                }
+            }
+        }
+
+        const auto l = r.x >> 3, rr = (r.x + w - 1) >> 3;
+        if (dy > 0) {
+            const auto from = ((r.y + h - 1) >> 3) + 1, to = (r.y + h - 1 + dy) >> 3;
+            r.y += dy;
+            for (auto c = from; c <= to; c++) {
+                if (line_any(index.rows, mask, c, l, rr)) {
+                    r.y = c * 8 - h;
+                    r.hit_y = true;
+                    break;
+                }
+            }
+        } else if (dy < 0) {
+            const auto from = (r.y >> 3) - 1, to = (r.y + dy) >> 3;
+            r.y += dy;
+            for (auto c = from; c >= to; c--) {
+                if (line_any(index.rows, mask, c, l, rr)) {
+                    r.y = (c + 1) * 8;
+                    r.hit_y = true;
+                    break;
+                }
+            }
+        }
+
+        return r;
+    }
+
+    void col_touch_tile(VirtualMemory *m, int x, int y) {
+        if (index.owner == m && index.valid)
+            set_tile(x, y, m->flags[m->map[y * 128 + x]]);
+    }
+
+    void col_touch_sprite(VirtualMemory *m, uint8_t n) {
+        if (index.owner != m || !index.valid)
+            return;
+        for (auto i = 0; i < 128 * 128; i++)
+            if (m->map[i] == n)
+                set_tile(i & 127, i >> 7, m->flags[n]);
+    }
+
+    void col_invalidate(VirtualMemory *m) {
+        if (index.owner == m)
+            index.valid = false;
+    }
+}
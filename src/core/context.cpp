@@ -1 +1,46 @@
-#include "core/context.h"
\ No newline at end of file
+#include "core/context.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace t8::core {
+
+    void ctx_swap_memory(AppContext *ctx, bool exec) {
+        auto &pages = ctx->pages;
+        mem_track(&ctx->base_memory, &pages.edited);
+        mem_track(&ctx->exec_memory, &pages.written);
+
+        if (!exec) {
+            ctx->memory = &ctx->base_memory;
+            return;
+        }
+
+        // 每次运行都从卡带镜像开始: 只有两边写入过的页可能不同, 其余的页保持共享的内容
+        const auto dirty = pages.edited | pages.written;
+        const auto src = reinterpret_cast<const uint8_t *>(&ctx->base_memory);
+        const auto dst = reinterpret_cast<uint8_t *>(&ctx->exec_memory);
+        for (uint32_t page = 0; page < MEM_PAGE_COUNT; page++) {
+            if (!dirty.test(page))
+                continue;
+
+            // 连续的页合并为一次复制
+            auto end = page + 1;
+            while (end < MEM_PAGE_COUNT && dirty.test(end))
+                end++;
+            const auto addr = page << MEM_PAGE_SHIFT;
+            const auto size = std::min(end << MEM_PAGE_SHIFT, ADDR_END) - addr;
+            std::memcpy(dst + addr, src + addr, size);
+            mem_touch(&ctx->exec_memory, addr, size);
+            page = end;
+        }
+
+        pages.edited.reset();
+        pages.written.reset();
+        ctx->memory = &ctx->exec_memory;
+    }
+
+    PageSet ctx_changed_pages(const AppContext *ctx) {
+        return ctx->pages.edited | ctx->pages.written;
+    }
+
+}
@@ -1,14 +1,27 @@
 #include "core/emulator.h"
+#include "core/cart.h"
 #include "core/context.h"
 #include "core/gfx.h"
+#include "core/golden.h"
 #include "core/memory.h"
+#include "core/rewind.h"
 #include "core/window.h"
 #include "input/gamepad.h"
 #include "input/keyboard.h"
 #include "input/mouse.h"
+#include "input/replay.h"
+#include "scene/console.h"
+#include "scene/executor.h"
 
 #include "constants.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
 #include <thread>
 
 using namespace t8::input;
@@ -18,27 +31,62 @@ using namespace t8::core;
 
 namespace t8::core {
     static void scene_update(AppContext *ctx) {
+        if (ctx->scene == SCENE_ID_CONSOLE)
+            scene::console::update(*ctx);
+        if (ctx->scene == SCENE_ID_EXECUTOR)
+            scene::executor::update(*ctx);
     }
 
     static void scene_draw(AppContext *ctx) {
+        if (ctx->scene == SCENE_ID_CONSOLE)
+            scene::console::draw(*ctx);
+        if (ctx->scene == SCENE_ID_EXECUTOR)
+            scene::executor::draw(*ctx);
     }
 
     static void scene_enter(AppContext *ctx) {
+        if (ctx->scene == SCENE_ID_CONSOLE)
+            scene::console::enter(*ctx);
+        if (ctx->scene == SCENE_ID_EXECUTOR)
+            scene::executor::enter(*ctx);
     }
 
     static void scene_leave(AppContext *ctx) {
+        if (ctx->scene == SCENE_ID_CONSOLE)
+            scene::console::leave(*ctx);
+        if (ctx->scene == SCENE_ID_EXECUTOR)
+            scene::executor::leave(*ctx);
     }
 
+    // 每次运行结束时输出快照编码的统计, bench/rewind.zip 用于对比
+    static void log_rewind(AppContext *ctx) {
+        const auto &r = ctx->rewind;
+        if (!r.enabled || r.pushes == 0)
+            return;
+
+        SDL_Log("rewind: %zu ticks in %zu bytes, encode %llu us avg, %llu us max",
+                rwd_frames(r),
+                rwd_bytes(r),
+                static_cast<unsigned long long>(r.encode_us_total / r.pushes),
+                static_cast<unsigned long long>(r.encode_us_max));
+    }
+
+    // 编辑器场景尚未迁回构建, 切换到编辑器的请求被忽略
     static void scene_swap(AppContext *ctx, uint16_t next) {
+        if (next != SCENE_ID_CONSOLE && next != SCENE_ID_EXECUTOR)
+            return;
+
+        if (ctx->scene == SCENE_ID_EXECUTOR)
+            log_rewind(ctx);
+        scene_leave(ctx);
+        ctx->scene = next;
+        rwd_reset(ctx->rewind);
+        scene_enter(ctx);
     }
 
-    bool emu_init(AppContext *ctx) {
+    static void setup_memory(AppContext *ctx) {
         auto mem = ctx->memory;
 
-        if (!wnd_init(ctx->window, 128, 128, ctx->pixel_size)) {
-            return false;
-        }
-
         gfx_palc(mem, 0, _RGBA(0, 0, 0, 255));
         gfx_palc(mem, 1, _RGBA(250, 250, 250, 255));
         gfx_palc(mem, 2, _RGBA(190, 190, 190, 255));
@@ -58,6 +106,19 @@ namespace t8::core {
         std::memcpy(&mem->default_font, FONT_DATA, 2048);
         std::memcpy(&mem->custom_font, FONT_DATA, 2048);
 
+        gfx_reset(mem);
+    }
+
+    bool emu_init(AppContext *ctx) {
+        if (!wnd_init(ctx->window, 128, 128, ctx->pixel_size)) {
+            return false;
+        }
+
+        setup_memory(ctx);
+        if (ctx->rewind.enabled)
+            rwd_init(ctx->rewind);
+        scene_swap(ctx, SCENE_ID_CONSOLE);
+
         return true;
     }
 
@@ -113,43 +174,81 @@ namespace t8::core {
         }
     }
 
-    static void on_event(AppContext *ctx, const SDL_Event &e) {
+    // 主线程与模拟线程之间的交接区:
+    // 主线程把事件写入待交付的输入, 模拟线程在每个 tick 开始时取走;
+    // 模拟线程把绘制完的帧写入三重缓冲, 主线程取最新的一帧转换并显示
+    struct Pipeline {
+        std::mutex input_lock;
+        MouseState mouse;
+        KeyboardState keyboard;
+        GamepadState gamepad;
+        utils::RingQueue<InputText, 64> inputs;
+
+        std::mutex frame_lock;
+        GoldenFrame frames[3];
+        int write = 0;
+        int latest = 1;
+        int read = 2;
+        bool fresh = false;
+
+        std::atomic<int> text_input{-1};
+        std::atomic<bool> running{true};
+
+        // 最近一个 tick 是否在回退, 回退期间显示快照中的屏幕
+        bool rewinding = false;
+    };
+
+    static void on_event(AppContext *ctx, Pipeline &pipe, const SDL_Event &e) {
+        std::lock_guard lock(pipe.input_lock);
+
         switch (e.type) {
         case SDL_EVENT_MOUSE_MOTION:
         case SDL_EVENT_MOUSE_BUTTON_DOWN:
         case SDL_EVENT_MOUSE_BUTTON_UP:
         case SDL_EVENT_MOUSE_WHEEL: {
-            on_mouse(ctx->mouse, e, ctx->pixel_size);
+            on_mouse(pipe.mouse, e, ctx->pixel_size);
             break;
         }
         case SDL_EVENT_KEY_DOWN:
         case SDL_EVENT_KEY_UP: {
-            on_keybd(ctx->keyboard, e);
+            on_keybd(pipe.keyboard, e);
             break;
         }
         case SDL_EVENT_TEXT_INPUT: {
-            ctx->inputs.push(e.text.text);
+            // 按输入槽容量切分, 不截断 UTF-8 字符
+            std::string_view text = e.text.text ? e.text.text : "";
+            while (!text.empty()) {
+                auto n = std::min(text.size(), InputText::capacity());
+                while (n < text.size() && n > 0 && (text[n] & 0xC0) == 0x80)
+                    n -= 1;
+                // 没有字符起始字节时整段取走, 避免死循环
+                if (n == 0)
+                    n = std::min(text.size(), InputText::capacity());
+                pipe.inputs.push(InputText(text.substr(0, n)));
+                text.remove_prefix(n);
+            }
             break;
         }
         case SDL_EVENT_GAMEPAD_AXIS_MOTION:
         case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
         case SDL_EVENT_GAMEPAD_BUTTON_UP: {
-            on_gamepad(ctx->gamepad, e);
+            on_gamepad(pipe.gamepad, e);
             break;
         }
         }
     }
 
-    static void on_signal(AppContext *ctx) {
+    // 在模拟线程中处理, 窗口相关的操作转交主线程
+    static void on_signal(AppContext *ctx, Pipeline &pipe) {
         while (!ctx->signals.empty()) {
             const auto s = ctx->signals.front();
             ctx->signals.pop();
 
             if (s.type == SIGNAL_START_INPUT) {
-                wnd_input(ctx->window, true);
+                pipe.text_input = 1;
             }
             if (s.type == SIGNAL_STOP_INPUT) {
-                wnd_input(ctx->window, false);
+                pipe.text_input = 0;
             }
             if (s.type == SIGNAL_SWAP_EDITOR) {
                 scene_swap(ctx, SCENE_ID_EDITOR);
@@ -161,54 +260,268 @@ namespace t8::core {
                 scene_swap(ctx, SCENE_ID_EXECUTOR);
             }
             if (s.type == SIGNAL_EXCEPTION) {
+                scene::console::print(*ctx, s.value.c_str(), true);
                 scene_swap(ctx, SCENE_ID_CONSOLE);
             }
-            if (s.type == SIGNAL_PRINT) {
+            if (s.type == SIGNAL_TRACE) {
+                scene::console::print(*ctx, s.value.c_str(), true);
+            }
+            // 脚本的 log 每帧都可能调用, 不进入控制台; 只有性能报告与重载结果这类低频消息才显示
+            if (s.type == SIGNAL_REPORT) {
+                scene::console::print(*ctx, s.value.c_str(), false);
             }
         }
     }
 
-    void emu_run(AppContext *ctx) {
+    // 取走主线程累积的输入; 回放期间输入全部来自录制流, 只丢弃实时输入
+    static void take_input(AppContext *ctx, Pipeline &pipe) {
+        std::lock_guard lock(pipe.input_lock);
+
+        if (!rec_replaying(ctx->recorder)) {
+            auto &m = ctx->mouse;
+            m.x = pipe.mouse.x;
+            m.y = pipe.mouse.y;
+            m.z = pipe.mouse.z;
+            m.dx = pipe.mouse.dx;
+            m.dy = pipe.mouse.dy;
+            m.current = pipe.mouse.current;
+
+            auto &k = ctx->keyboard;
+            std::memcpy(k.current, pipe.keyboard.current, sizeof(k.current));
+            std::memcpy(k.repeated, pipe.keyboard.repeated, sizeof(k.repeated));
+            k.mod = pipe.keyboard.mod;
+
+            auto &g = ctx->gamepad;
+            for (auto i = 0; i < 4; i++) {
+                g.current[i] = pipe.gamepad.current[i];
+                g.mapper[i] = pipe.gamepad.mapper[i];
+            }
+        }
 
-        SDL_Event e;
+        for (; !pipe.inputs.empty(); pipe.inputs.pop()) {
+            const auto &text = pipe.inputs.front();
+            if (rec_replaying(ctx->recorder))
+                continue;
+            ctx->inputs.push(text);
+            rec_text(ctx->recorder, text.view());
+        }
 
-        while (true) {
+        // 累积量已交付, 按键状态保留到下次事件
+        pipe.mouse.z = 0;
+        pipe.mouse.dx = 0;
+        pipe.mouse.dy = 0;
+        std::memset(pipe.keyboard.repeated, 0, sizeof(pipe.keyboard.repeated));
+    }
 
-            while (wnd_event(e)) {
-                if (e.type == SDL_EVENT_QUIT) {
-                    return;
-                }
-                on_event(ctx, e);
-            }
+    static void publish_frame(AppContext *ctx, Pipeline &pipe) {
+        gld_capture(ctx->memory, pipe.frames[pipe.write]);
 
-            auto timer = &ctx->timer;
-            auto steps = timer->steps();
+        std::lock_guard lock(pipe.frame_lock);
+        std::swap(pipe.write, pipe.latest);
+        pipe.fresh = true;
+    }
 
-            if (steps > 0) {
+    static void simulate(AppContext *ctx, Pipeline &pipe) {
+        auto timer = &ctx->timer;
+        auto steps = timer->steps();
+
+        if (steps > 0) {
+            take_input(ctx, pipe);
+
+            rec_tick(ctx->recorder, ctx->gamepad, ctx->keyboard, ctx->mouse, [ctx](std::string_view text) {
+                ctx->inputs.push(InputText(text));
+            });
+
+            // 运行脚本时按住回退键逐 tick 还原快照, 否则正常推进
+            const auto rewind = ctx->rewind.enabled && ctx->scene == SCENE_ID_EXECUTOR;
+            pipe.rewinding = rewind && k_down(ctx->keyboard, SCANCODE_REWIND);
+            if (pipe.rewinding)
+                rwd_step(ctx->rewind, ctx->memory);
+            else
                 scene_update(ctx);
-                m_flush(ctx->mouse);
-                k_flush(ctx->keyboard);
-                g_flush(ctx->gamepad);
-            }
+            m_flush(ctx->mouse);
+            k_flush(ctx->keyboard);
+            g_flush(ctx->gamepad);
+        }
 
-            timer->consume(steps);
+        timer->consume(steps);
 
+        // 独立线程下没有新 tick 时画面不会变化, 不必重复绘制
+        if (steps == 0 && ctx->threaded)
+            return;
+
+        // 快照只包含 VirtualMemory, Lua 中的变量不会回退; 回退期间调用 draw 只会按实时状态重画,
+        // 因此跳过绘制, 直接显示快照中的屏幕
+        if (!pipe.rewinding) {
             scene_draw(ctx);
+            // 在绘制之后记录, 快照中的屏幕即该 tick 显示的画面
+            if (steps > 0 && ctx->rewind.enabled && ctx->scene == SCENE_ID_EXECUTOR)
+                rwd_push(ctx->rewind, ctx->memory);
+        }
+        publish_frame(ctx, pipe);
 
-            auto p = ctx->buffer;
-            for (auto y = 0; y < 128; y++) {
-                for (auto x = 0; x < 128; x++) {
-                    auto n = gfx_pget(ctx->memory, x, y);
-                    n = gfx_pal(ctx->memory, n);
-                    *(p++) = ctx->memory->palette[n];
-                }
+        on_signal(ctx, pipe);
+    }
+
+    // 始终显示屏幕本身, 与当前绘制目标无关
+    static void present(AppContext *ctx, Pipeline &pipe) {
+        const auto text_input = pipe.text_input.exchange(-1);
+        if (text_input >= 0)
+            wnd_input(ctx->window, text_input);
+
+        {
+            std::lock_guard lock(pipe.frame_lock);
+            if (!pipe.fresh)
+                return;
+            std::swap(pipe.read, pipe.latest);
+            pipe.fresh = false;
+        }
+
+        const auto &frame = pipe.frames[pipe.read];
+        auto p = ctx->buffer;
+        for (const auto n : frame.screen) {
+            *(p++) = frame.palette[n & 0xF];
+            *(p++) = frame.palette[n >> 4];
+        }
+
+        wnd_draw(ctx->window, ctx->buffer);
+    }
+
+    static bool poll_events(AppContext *ctx, Pipeline &pipe) {
+        SDL_Event e;
+        while (wnd_event(e)) {
+            if (e.type == SDL_EVENT_QUIT)
+                return false;
+            on_event(ctx, pipe, e);
+        }
+        return true;
+    }
+
+    void emu_run(AppContext *ctx) {
+        auto pipe = std::make_unique<Pipeline>();
+
+        if (!ctx->threaded) {
+            while (poll_events(ctx, *pipe)) {
+                simulate(ctx, *pipe);
+                present(ctx, *pipe);
+                std::this_thread::sleep_for(std::chrono::milliseconds(3));
             }
+            return;
+        }
 
-            wnd_draw(ctx->window, ctx->buffer);
+        // 模拟线程负责 tick 推进与脚本执行, 主线程只处理事件和显示
+        std::thread worker([ctx, &pipe]() {
+            while (pipe->running) {
+                simulate(ctx, *pipe);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
 
-            on_signal(ctx);
+        while (poll_events(ctx, *pipe)) {
+            present(ctx, *pipe);
             std::this_thread::sleep_for(std::chrono::milliseconds(3));
         }
+
+        pipe->running = false;
+        worker.join();
+    }
+
+    // 无窗口运行卡带: 按脚本逐 tick 输入, 将每帧哈希与 golden 文件比对
+    int emu_verify(AppContext *ctx, const std::string &cart_file, const std::string &input_file, const std::string &golden_file, bool update) {
+        std::vector<uint32_t> masks;
+        if (!gld_load_inputs(masks, input_file)) {
+            SDL_Log("Failed to load input script: %s", input_file.c_str());
+            return 2;
+        }
+
+        auto golden = std::make_unique<GoldenFile>();
+        if (update) {
+            gld_reset(*golden);
+        } else if (!gld_load(*golden, golden_file)) {
+            SDL_Log("Failed to load golden file: %s", golden_file.c_str());
+            return 2;
+        }
+
+        setup_memory(ctx);
+        if (!cart_load(*ctx, cart_file)) {
+            SDL_Log("Failed to load cart: %s", cart_file.c_str());
+            return 2;
+        }
+        if (ctx->script.empty()) {
+            SDL_Log("Cart has no script: %s", cart_file.c_str());
+            return 2;
+        }
+
+        if (ctx->rewind.enabled)
+            rwd_init(ctx->rewind);
+        ctx->deterministic = true;
+        scene_swap(ctx, SCENE_ID_EXECUTOR);
+
+        auto frame = std::make_unique<GoldenFrame>();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (size_t tick = 0; tick < masks.size(); tick++) {
+            for (auto i = 0; i < 4; i++)
+                g_set(ctx->gamepad, i, (masks[tick] >> (i * 8)) & 0xFF);
+
+            scene_update(ctx);
+            m_flush(ctx->mouse);
+            k_flush(ctx->keyboard);
+            g_flush(ctx->gamepad);
+            ctx->timer.consume(1);
+            scene_draw(ctx);
+            if (ctx->rewind.enabled)
+                rwd_push(ctx->rewind, ctx->memory);
+
+            for (; !ctx->signals.empty(); ctx->signals.pop()) {
+                const auto &signal = ctx->signals.front();
+                if (signal.type == SIGNAL_EXCEPTION) {
+                    SDL_Log("Script error at tick %zu: %s", tick, signal.value.c_str());
+                    for (ctx->signals.pop(); !ctx->signals.empty() && ctx->signals.front().type == SIGNAL_TRACE; ctx->signals.pop())
+                        SDL_Log("%s", ctx->signals.front().value.c_str());
+                    return 1;
+                }
+            }
+
+            gld_capture(ctx->memory, *frame);
+
+            if (update) {
+                gld_append(*golden, *frame);
+                continue;
+            }
+
+            uint64_t expected;
+            if (!gld_next(*golden, expected)) {
+                SDL_Log("Golden file ends at tick %zu", tick);
+                return 1;
+            }
+
+            const auto actual = gld_hash(*frame);
+            if (actual != expected) {
+                const auto diff_file = golden_file + "." + std::to_string(tick) + ".png";
+                gld_write_diff(diff_file, golden->frame, *frame);
+                SDL_Log("Frame diverges at tick %zu: expected %016llx, got %016llx (%s)",
+                        tick,
+                        static_cast<unsigned long long>(expected),
+                        static_cast<unsigned long long>(actual),
+                        diff_file.c_str());
+                return 1;
+            }
+        }
+
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        SDL_Log("%zu ticks %s in %lld ms", masks.size(), update ? "recorded" : "verified", static_cast<long long>(ms));
+
+        log_rewind(ctx);
+
+        if (update && !gld_save(*golden, golden_file)) {
+            SDL_Log("Failed to save golden file: %s", golden_file.c_str());
+            return 2;
+        }
+
+        return 0;
     }
 
     void emu_quit(AppContext *ctx) {
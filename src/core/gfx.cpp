@@ -1,9 +1,13 @@
 #include "core/gfx.h"
+#include "core/collision.h"
 #include "core/memory.h"
 #include "utils/algo.h"
 
 #include <algorithm>
+#include <bitset>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 namespace t8::core {
     union bitfield_4 {
@@ -15,10 +19,51 @@ namespace t8::core {
         };
     };
 
+    // 额外绘制表面按需分配, 由所有 VirtualMemory 共享
+    // 它们不在 VirtualMemory 之内, 回退快照与 golden 哈希都不包含其内容, 离开执行器时释放
+    static std::unique_ptr<uint8_t[]> extra_surfaces[SURFACE_EXTRA_COUNT];
+
+    // 地图预渲染缓存: 世界被切分为 8x8 个 128x128 像素的块
+    struct MapChunk {
+        std::unique_ptr<uint8_t[]> pixels;
+        std::bitset<256> sprites;
+        uint16_t present[16];
+        int layers = -1;
+    };
+
+    static struct {
+        bool enabled = false;
+        const VirtualMemory *owner = nullptr;
+        MapChunk chunks[64];
+    } map_cache;
+
+    static inline void map_cache_touch_tile(VirtualMemory *m, int x, int y) {
+        if (map_cache.owner == m)
+            map_cache.chunks[(y >> 4) * 8 + (x >> 4)].layers = -1;
+    }
+
+    static inline void map_cache_touch_sprite(VirtualMemory *m, int x, int y) {
+        if (map_cache.owner != m)
+            return;
+        const auto id = ((y >> 3) << 4) | (x >> 3);
+        for (auto &chunk : map_cache.chunks) {
+            if (chunk.sprites.test(id))
+                chunk.layers = -1;
+        }
+    }
+
+    static inline uint8_t *draw_surface(VirtualMemory *m) {
+        if (m->draw_target == SURFACE_SCREEN)
+            return m->screen;
+        auto p = gfx_surface(m, m->draw_target);
+        return p ? p : m->screen;
+    }
+
     void gfx_reset(VirtualMemory *m) {
         gfx_reset_palette(m);
         gfx_clip(m);
         gfx_camera(m);
+        gfx_target(m);
     }
 
     void gfx_clip(VirtualMemory *m, int x, int y, int w, int h) {
@@ -34,16 +79,31 @@ namespace t8::core {
         m->view_clip[1] = static_cast<uint8_t>(t);
         m->view_clip[2] = static_cast<uint8_t>(r - l);
         m->view_clip[3] = static_cast<uint8_t>(b - t);
+        mem_mark(m, ADDR_VIEW_CLIP, sizeof(m->view_clip));
     }
 
     void gfx_camera(VirtualMemory *m, int8_t x, int8_t y) {
         m->draw_offset[0] = x;
         m->draw_offset[1] = y;
+        mem_mark(m, ADDR_DRAW_OFFSET, sizeof(m->draw_offset));
+    }
+
+    bool gfx_target(VirtualMemory *m, uint8_t id) {
+        if (!gfx_surface(m, id))
+            return false;
+        // 绘制到精灵图期间的改动无法逐像素跟踪
+        if (m->draw_target == SURFACE_SPRITE || id == SURFACE_SPRITE)
+            gfx_map_invalidate(m);
+        m->draw_target = id;
+        mem_mark(m, ADDR_DRAW_TARGET, sizeof(m->draw_target));
+        return true;
     }
 
     void gfx_clear(VirtualMemory *m, uint8_t c) {
         c = (c & 0xF) | ((c & 0xF) << 4);
-        std::fill(m->screen, m->screen + sizeof(m->screen), c);
+        auto surface = draw_surface(m);
+        std::fill(surface, surface + sizeof(m->screen), c);
+        mem_mark(m, surface, sizeof(m->screen));
     }
 
     void gfx_palt(VirtualMemory *m, uint8_t color, bool t) {
@@ -52,10 +112,12 @@ namespace t8::core {
         } else {
             m->palette_mask &= ~static_cast<uint16_t>(1 < color);
         }
+        mem_mark(m, ADDR_PALETTE_MASK, sizeof(m->palette_mask));
     }
 
     void gfx_palt(VirtualMemory *m, uint16_t t) {
         m->palette_mask = t;
+        mem_mark(m, ADDR_PALETTE_MASK, sizeof(m->palette_mask));
     }
 
     void gfx_reset_palette(VirtualMemory *m) {
@@ -66,6 +128,7 @@ namespace t8::core {
 
     void gfx_palc(VirtualMemory *m, uint8_t index, uint32_t c) {
         m->palette[index & 0xF] = c;
+        mem_mark(m, &m->palette[index & 0xF], sizeof(c));
     }
 
     void gfx_pal(VirtualMemory *m, uint8_t n, uint8_t map) {
@@ -74,6 +137,7 @@ namespace t8::core {
         auto buffer = reinterpret_cast<bitfield_4 *>(m->palette_mapping);
         auto field = &buffer[n >> 1];
         (n & 0x1) ? (field->lo = map) : (field->hi = map);
+        mem_mark(m, field, 1);
     }
 
     uint8_t gfx_pal(VirtualMemory *m, uint8_t n) {
@@ -93,37 +157,40 @@ namespace t8::core {
             y >= m->view_clip[1] + m->view_clip[3])
             return;
 
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return;
 
-        auto buffer = reinterpret_cast<bitfield_4 *>(m->screen);
+        auto buffer = reinterpret_cast<bitfield_4 *>(draw_surface(m));
         auto t = (y * 128 + x);
         auto field = &buffer[t >> 1];
         if (!(m->palette_mask & (1 << color))) {
             (t & 1) ? (field->lo = color) : (field->hi = color);
+            mem_mark(m, field, 1);
         }
     }
 
     uint8_t gfx_pget(VirtualMemory *m, int x, int y) {
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return 0;
-        auto buffer = reinterpret_cast<bitfield_4 *>(m->screen);
+        auto buffer = reinterpret_cast<bitfield_4 *>(draw_surface(m));
         auto t = (y * 128 + x);
         auto field = &buffer[t >> 1];
         return (t & 1) ? (field->lo) : (field->hi);
     }
 
     void gfx_sset(VirtualMemory *m, int x, int y, uint8_t color) {
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return;
         auto buffer = reinterpret_cast<bitfield_4 *>(m->sprite);
         auto t = (y * 128 + x);
         auto field = &buffer[t >> 1];
         (t & 1) ? (field->lo = color) : (field->hi = color);
+        mem_mark(m, field, 1);
+        map_cache_touch_sprite(m, x & 0x7F, y & 0x7F);
     }
 
     uint8_t gfx_sget(VirtualMemory *m, int x, int y) {
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return 0;
         auto buffer = reinterpret_cast<bitfield_4 *>(m->sprite);
         auto t = (y * 128 + x);
@@ -136,6 +203,9 @@ namespace t8::core {
             return;
         auto i = (y * 128 + x);
         m->map[i] = n;
+        mem_mark(m, &m->map[i], 1);
+        map_cache_touch_tile(m, x, y);
+        col_touch_tile(m, x, y);
     }
 
     uint8_t gfx_mget(VirtualMemory *m, int x, int y) {
@@ -147,6 +217,8 @@ namespace t8::core {
 
     void gfx_fset(VirtualMemory *m, uint8_t n, uint8_t f) {
         m->flags[n] = f;
+        mem_mark(m, &m->flags[n], 1);
+        col_touch_sprite(m, n);
     }
 
     uint8_t gfx_fget(VirtualMemory *m, uint8_t n) {
@@ -154,16 +226,17 @@ namespace t8::core {
     }
 
     void gfx_ftset(VirtualMemory *m, int x, int y, bool value, bool custom) {
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return;
         auto buffer = custom ? m->custom_font : m->default_font;
         auto t = (y * 128 + x);
         auto field = &buffer[t >> 3];
         value ? (*field |= (1 << (t & 0b111))) : (*field &= ~(1 << (t & 0b111)));
+        mem_mark(m, field, 1);
     }
 
     bool gfx_ftget(VirtualMemory *m, int x, int y, bool custom) {
-        if (x < 0 || x > 128 || y < 0 || y > 128)
+        if (x < 0 || x >= 128 || y < 0 || y >= 128)
             return false;
         auto buffer = custom ? m->custom_font : m->default_font;
         auto t = (y * 128 + x);
@@ -271,4 +344,320 @@ namespace t8::core {
         }
     }
 
+    void gfx_spr(VirtualMemory *m, uint8_t n, int x, int y, int scale, uint8_t flags) {
+        scale = std::clamp(scale, 1, 4);
+        const auto sprite_x = (n & 0xF) << 3;
+        const auto sprite_y = ((n >> 4) & 0xF) << 3;
+
+        for (auto dy = 0; dy < 8; dy++) {
+            for (auto dx = 0; dx < 8; dx++) {
+                auto tx = (flags & 0b1) ? 7 - dx : dx;
+                auto ty = (flags & 0b10) ? 7 - dy : dy;
+
+                if (flags & 0b100) {
+                    const auto t = tx;
+                    tx = ty;
+                    ty = 7 - t;
+                }
+
+                if (flags & 0b1000) {
+                    tx = 7 - tx;
+                    ty = 7 - ty;
+                }
+
+                const auto color = gfx_sget(m, sprite_x + tx, sprite_y + ty);
+                if (scale == 1)
+                    gfx_pset(m, x + dx, y + dy, color);
+                else
+                    gfx_rect(m, x + dx * scale, y + dy * scale, scale, scale, color, true);
+            }
+        }
+    }
+
+    uint8_t *gfx_surface(VirtualMemory *m, uint8_t id) {
+        switch (id) {
+        case SURFACE_SCREEN:
+            return m->screen;
+        case SURFACE_SPRITE:
+            return m->sprite;
+        }
+
+        if (id < SURFACE_EXTRA || id >= SURFACE_EXTRA + SURFACE_EXTRA_COUNT)
+            return nullptr;
+
+        auto &surface = extra_surfaces[id - SURFACE_EXTRA];
+        if (!surface) {
+            surface = std::make_unique<uint8_t[]>(sizeof(VirtualMemory::screen));
+        }
+        return surface.get();
+    }
+
+    void gfx_release_surfaces() {
+        for (auto &surface : extra_surfaces)
+            surface.reset();
+    }
+
+    // 将一行源像素按目标 x 的奇偶对齐到 out 中, 像素 i 位于半字节 (dx & 1) + i
+    static void blit_fetch_row(const uint8_t *row, int sx, int dx, int w, uint8_t *out) {
+        uint8_t padded[66]{0};
+        std::memcpy(padded + 1, row, 64);
+
+        const auto off = dx & 1;
+        const auto count = (off + w + 1) >> 1;
+
+        if ((sx & 1) == off) {
+            std::memcpy(out, padded + 1 + (sx >> 1), count);
+            return;
+        }
+
+        // 奇偶不同时整体移动半个字节
+        const auto base = 1 + ((sx - off) >> 1);
+        for (auto k = 0; k < count; k++) {
+            out[k] = static_cast<uint8_t>((padded[base + k] >> 4) | (padded[base + k + 1] << 4));
+        }
+    }
+
+    // transparent 为透明色掩码, 第 n 位表示颜色 n 不写入
+    static void blit_store_row(uint8_t *row, const uint8_t *in, int dx, int w, uint16_t transparent) {
+        const auto off = dx & 1;
+        const auto count = (off + w + 1) >> 1;
+        row += dx >> 1;
+
+        const auto store = [&](int k, uint8_t mask) {
+            const auto v = in[k];
+            if (transparent) {
+                if (transparent & (1 << (v & 0x0F)))
+                    mask &= 0xF0;
+                if (transparent & (1 << (v >> 4)))
+                    mask &= 0x0F;
+            }
+            row[k] = static_cast<uint8_t>((row[k] & ~mask) | (v & mask));
+        };
+
+        auto begin = 0;
+        auto end = count;
+
+        // 首尾字节只写入属于区域的半字节
+        if (off) {
+            store(0, 0xF0);
+            begin = 1;
+        }
+        if (((off + w) & 1) && end > begin) {
+            store(count - 1, 0x0F);
+            end -= 1;
+        }
+
+        if (!transparent) {
+            if (end > begin)
+                std::memcpy(row + begin, in + begin, end - begin);
+        } else {
+            for (auto k = begin; k < end; k++)
+                store(k, 0xFF);
+        }
+    }
+
+    void gfx_blit(VirtualMemory *m, uint8_t src, int sx, int sy, int w, int h, uint8_t dst, int dx, int dy, int key) {
+        const auto sp = gfx_surface(m, src);
+        const auto dp = gfx_surface(m, dst);
+        if (!sp || !dp || key > 15)
+            return;
+
+        // 按源与目标的边界裁剪
+        const auto clip_lo = [&](int &a, int &b, int &size) {
+            const auto d = std::max({0, -a, -b});
+            a += d;
+            b += d;
+            size -= d;
+        };
+        clip_lo(sx, dx, w);
+        clip_lo(sy, dy, h);
+        w = std::min({w, 128 - sx, 128 - dx});
+        h = std::min({h, 128 - sy, 128 - dy});
+        if (w <= 0 || h <= 0)
+            return;
+
+        // 同一表面向下复制时自底向上, 避免覆盖尚未读取的行
+        const auto reverse = sp == dp && dy > sy;
+        uint8_t buffer[65];
+
+        for (auto i = 0; i < h; i++) {
+            const auto r = reverse ? h - 1 - i : i;
+            blit_fetch_row(sp + (sy + r) * 64, sx, dx, w, buffer);
+            blit_store_row(dp + (dy + r) * 64, buffer, dx, w, key >= 0 ? 1 << key : 0);
+        }
+        mem_mark(m, dp + dy * 64, h * 64);
+
+        if (dst == SURFACE_SPRITE)
+            gfx_map_invalidate(m);
+    }
+
+    void gfx_map_cache(bool enable) {
+        map_cache.enabled = enable;
+        if (!enable) {
+            map_cache.owner = nullptr;
+            for (auto &chunk : map_cache.chunks) {
+                chunk.pixels.reset();
+                chunk.layers = -1;
+            }
+        }
+    }
+
+    void gfx_map_invalidate(VirtualMemory *m) {
+        if (map_cache.owner != m)
+            return;
+        for (auto &chunk : map_cache.chunks)
+            chunk.layers = -1;
+    }
+
+    static MapChunk &map_chunk(VirtualMemory *m, int index, uint8_t layers) {
+        auto &chunk = map_cache.chunks[index];
+        if (chunk.layers == layers)
+            return chunk;
+
+        if (!chunk.pixels)
+            chunk.pixels = std::make_unique<uint8_t[]>(sizeof(VirtualMemory::screen));
+
+        chunk.sprites.reset();
+        chunk.layers = layers;
+
+        const auto cx = (index & 7) << 4;
+        const auto cy = (index >> 3) << 4;
+
+        for (auto ty = 0; ty < 16; ty++) {
+            chunk.present[ty] = 0;
+            for (auto tx = 0; tx < 16; tx++) {
+                const auto id = m->map[(cy + ty) * 128 + cx + tx];
+                if (!(id & layers))
+                    continue;
+
+                chunk.present[ty] |= 1 << tx;
+                chunk.sprites.set(id);
+
+                // 精灵与块内的格子都按 8 像素 (4 字节) 对齐
+                const auto src = m->sprite + ((id >> 4) << 3) * 64 + ((id & 0xF) << 2);
+                const auto dst = chunk.pixels.get() + (ty << 3) * 64 + (tx << 2);
+                for (auto r = 0; r < 8; r++)
+                    std::memcpy(dst + r * 64, src + r * 64, 4);
+            }
+        }
+
+        return chunk;
+    }
+
+    // 从缓存块逐行复制, 效果等同于逐像素 gfx_pset
+    static void map_draw_cached(VirtualMemory *m, int mx, int my, int mw, int mh, int sx, int sy, uint8_t layers) {
+        if (map_cache.owner != m) {
+            map_cache.owner = m;
+            for (auto &chunk : map_cache.chunks)
+                chunk.layers = -1;
+        }
+
+        const auto ox = sx - (mx << 3) + m->draw_offset[0];
+        const auto oy = sy - (my << 3) + m->draw_offset[1];
+
+        // 裁剪区域再按 128x128 的表面收紧, 与 gfx_blit 一样不信任内存中的值
+        const auto cl = std::min(static_cast<int>(m->view_clip[0]), 128);
+        const auto ct = std::min(static_cast<int>(m->view_clip[1]), 128);
+        const auto cr = std::min(cl + m->view_clip[2], 128);
+        const auto cb = std::min(ct + m->view_clip[3], 128);
+
+        const auto x0 = std::max(cl, (mx << 3) + ox);
+        const auto x1 = std::min(cr, ((mx + mw) << 3) + ox);
+        const auto y0 = std::max(ct, (my << 3) + oy);
+        const auto y1 = std::min(cb, ((my + mh) << 3) + oy);
+        if (x0 >= x1 || y0 >= y1)
+            return;
+
+        for (auto cy = (y0 - oy) >> 7; cy <= (y1 - 1 - oy) >> 7; cy++)
+            for (auto cx = (x0 - ox) >> 7; cx <= (x1 - 1 - ox) >> 7; cx++)
+                map_chunk(m, cy * 8 + cx, layers);
+
+        const auto surface = draw_surface(m);
+        mem_mark(m, surface + y0 * 64, (y1 - y0) * 64);
+        uint8_t buffer[65];
+
+        for (auto y = y0; y < y1; y++) {
+            const auto wy = y - oy;
+            const auto ty = (wy >> 3) & 0xF;
+            const auto row = surface + y * 64;
+
+            auto wx = x0 - ox;
+            const auto wx_end = x1 - ox;
+
+            while (wx < wx_end) {
+                const auto &chunk = map_cache.chunks[(wy >> 7) * 8 + (wx >> 7)];
+                const auto chunk_end = std::min(wx_end, ((wx >> 7) + 1) << 7);
+
+                // 跳过未绘制的格子, 合并连续绘制的格子
+                if (!(chunk.present[ty] & (1 << ((wx >> 3) & 0xF)))) {
+                    wx = ((wx >> 3) + 1) << 3;
+                    continue;
+                }
+
+                auto run_end = wx;
+                while (run_end < chunk_end && (chunk.present[ty] & (1 << ((run_end >> 3) & 0xF))))
+                    run_end = ((run_end >> 3) + 1) << 3;
+                run_end = std::min(run_end, chunk_end);
+
+                const auto w = run_end - wx;
+                blit_fetch_row(chunk.pixels.get() + (wy & 0x7F) * 64, wx & 0x7F, wx + ox, w, buffer);
+                blit_store_row(row, buffer, wx + ox, w, m->palette_mask);
+
+                wx = run_end;
+            }
+        }
+    }
+
+    void gfx_map(VirtualMemory *m, int mx, int my, int mw, int mh, int sx, int sy, int scale, uint8_t layers) {
+        scale = std::clamp(scale, 1, 4);
+        const auto chunk_size = 8 * scale;
+
+        if (mx < 0) {
+            sx -= mx * chunk_size;
+            mw += mx;
+            mx = 0;
+        }
+
+        if (my < 0) {
+            sy -= my * chunk_size;
+            mh += my;
+            my = 0;
+        }
+
+        mw = std::min(mw, 128 - mx);
+        mh = std::min(mh, 128 - my);
+        if (mw <= 0 || mh <= 0)
+            return;
+
+        // 与原 map() 一致: 格子 x 绘制在 sx + x * chunk_size, 此后 sx 表示格子 mx 的位置
+        sx += mx * chunk_size;
+        sy += my * chunk_size;
+
+        if (map_cache.enabled && scale == 1 && m->draw_target != SURFACE_SPRITE) {
+            map_draw_cached(m, mx, my, mw, mh, sx, sy, layers);
+            return;
+        }
+
+        for (auto y = my; y < my + mh; y++) {
+            for (auto x = mx; x < mx + mw; x++) {
+                const auto id = m->map[y * 128 + x];
+                if (!(id & layers))
+                    continue;
+
+                const auto sprite_x = (id & 0xF) << 3;
+                const auto sprite_y = ((id >> 4) & 0xF) << 3;
+
+                for (auto dy = 0; dy < 8; dy++) {
+                    for (auto dx = 0; dx < 8; dx++) {
+                        const auto color = gfx_sget(m, sprite_x + dx, sprite_y + dy);
+                        gfx_rect(
+                            m,
+                            sx + (x - mx) * chunk_size + dx * scale,
+                            sy + (y - my) * chunk_size + dy * scale,
+                            scale, scale, color, true);
+                    }
+                }
+            }
+        }
+    }
 }
@@ -0,0 +1,157 @@
+#include "core/golden.h"
+#include "core/gfx.h"
+#include "core/memory.h"
+#include "utils/delta.h"
+#include "utils/png.h"
+#include "utils/varint.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace t8::utils;
+
+namespace t8::core {
+    static constexpr uint8_t GOLDEN_MAGIC[] = {'T', '8', 'G', 'F', 1};
+
+    void gld_capture(VirtualMemory *m, GoldenFrame &f) {
+        std::memcpy(f.screen, m->screen, sizeof(f.screen));
+        for (auto i = 0; i < 16; i++)
+            f.palette[i] = m->palette[gfx_pal(m, i)];
+    }
+
+    uint64_t gld_hash(const GoldenFrame &f) {
+        const auto p = reinterpret_cast<const uint8_t *>(&f);
+        uint64_t h = 0xCBF29CE484222325ULL;
+
+        for (size_t i = 0; i < sizeof(GoldenFrame); i += 8) {
+            uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w) * 0x100000001B3ULL;
+            h ^= h >> 29;
+        }
+
+        return h;
+    }
+
+    void gld_reset(GoldenFile &g) {
+        g.data.assign(std::begin(GOLDEN_MAGIC), std::end(GOLDEN_MAGIC));
+        g.cursor = sizeof(GOLDEN_MAGIC);
+        std::memset(&g.frame, 0, sizeof(g.frame));
+    }
+
+    void gld_append(GoldenFile &g, const GoldenFrame &f) {
+        const auto hash = gld_hash(f);
+        for (auto i = 0; i < 8; i++)
+            g.data.push_back(static_cast<uint8_t>(hash >> (i * 8)));
+
+        std::vector<uint8_t> delta(delta_bound(sizeof(GoldenFrame)));
+        const auto size = delta_encode(
+            delta.data(),
+            reinterpret_cast<const uint8_t *>(&f),
+            reinterpret_cast<const uint8_t *>(&g.frame),
+            sizeof(GoldenFrame));
+
+        uint8_t header[VARINT_MAX_BYTES];
+        g.data.insert(g.data.end(), header, header + varint_write(header, size));
+        g.data.insert(g.data.end(), delta.begin(), delta.begin() + size);
+
+        g.frame = f;
+    }
+
+    // 读出下一帧的哈希, 并把 g.frame 还原为该帧的期望画面
+    bool gld_next(GoldenFile &g, uint64_t &hash) {
+        if (g.cursor + 8 > g.data.size())
+            return false;
+
+        hash = 0;
+        for (auto i = 0; i < 8; i++)
+            hash |= static_cast<uint64_t>(g.data[g.cursor + i]) << (i * 8);
+        g.cursor += 8;
+
+        uint64_t size;
+        const auto begin = g.data.data();
+        const auto n = varint_read(begin + g.cursor, begin + g.data.size(), size);
+        if (!n || g.cursor + n + size > g.data.size())
+            return false;
+        g.cursor += n;
+
+        const auto ok = delta_apply(reinterpret_cast<uint8_t *>(&g.frame), begin + g.cursor, size, sizeof(GoldenFrame));
+        g.cursor += size;
+        return ok;
+    }
+
+    bool gld_load(GoldenFile &g, const std::string &file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+
+        g.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::memset(&g.frame, 0, sizeof(g.frame));
+        g.cursor = sizeof(GOLDEN_MAGIC);
+
+        return g.data.size() >= sizeof(GOLDEN_MAGIC) &&
+               std::memcmp(g.data.data(), GOLDEN_MAGIC, sizeof(GOLDEN_MAGIC)) == 0;
+    }
+
+    bool gld_save(const GoldenFile &g, const std::string &file_name) {
+        std::ofstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char *>(g.data.data()), g.data.size());
+        return file.good();
+    }
+
+    // 每行 "<tick 数> <按键掩码>", 掩码第 n 位对应 btn(n), '#' 开头为注释
+    bool gld_load_inputs(std::vector<uint32_t> &masks, const std::string &file_name) {
+        std::ifstream file(file_name);
+        if (!file)
+            return false;
+
+        masks.clear();
+        std::string line;
+        while (std::getline(file, line)) {
+            const auto comment = line.find('#');
+            if (comment != std::string::npos)
+                line.resize(comment);
+
+            std::istringstream is(line);
+            std::string count, mask;
+            if (!(is >> count))
+                continue;
+            if (!(is >> mask))
+                return false;
+
+            try {
+                masks.insert(masks.end(), std::stoul(count, nullptr, 0), static_cast<uint32_t>(std::stoul(mask, nullptr, 0)));
+            } catch (...) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // 左: 期望画面, 中: 实际画面, 右: 不同的像素标红
+    bool gld_write_diff(const std::string &file_name, const GoldenFrame &expected, const GoldenFrame &actual) {
+        std::vector<uint32_t> pixels(384 * 128);
+
+        for (auto y = 0; y < 128; y++) {
+            for (auto x = 0; x < 128; x++) {
+                const auto t = y * 128 + x;
+                const auto shift = (t & 1) ? 4 : 0;
+                const auto a = (expected.screen[t >> 1] >> shift) & 0xF;
+                const auto b = (actual.screen[t >> 1] >> shift) & 0xF;
+                const auto ca = expected.palette[a];
+                const auto cb = actual.palette[b];
+
+                pixels[y * 384 + x] = ca;
+                pixels[y * 384 + 128 + x] = cb;
+                pixels[y * 384 + 256 + x] = ca == cb ? ((ca & 0xFCFCFC00) >> 2) | 0xFF : 0xFF0000FF;
+            }
+        }
+
+        return png_write(file_name, pixels.data(), 384, 128);
+    }
+}
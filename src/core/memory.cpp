@@ -0,0 +1,155 @@
+#include "core/memory.h"
+#include "core/collision.h"
+#include "core/gfx.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace t8::core {
+    static inline const uint8_t *bytes(const VirtualMemory *m) {
+        return reinterpret_cast<const uint8_t *>(m);
+    }
+
+    static inline uint8_t *bytes(VirtualMemory *m) {
+        return reinterpret_cast<uint8_t *>(m);
+    }
+
+    // 越界部分被截掉
+    static inline uint32_t clamp_size(uint32_t addr, uint32_t size) {
+        if (addr >= ADDR_END)
+            return 0;
+        return std::min(size, ADDR_END - addr);
+    }
+
+    static inline bool overlaps(uint32_t addr, uint32_t size, uint32_t lo, uint32_t hi) {
+        return size && addr < hi && addr + size > lo;
+    }
+
+    // 裁剪区域、绘制偏移与绘制目标被所有绘制函数直接信任, 对脚本只读,
+    // 只能通过 clip/camera/target 修改; 覆盖到这段的整块写入在写后还原这几个字节
+    static constexpr uint32_t STATE_SIZE = ADDR_CACHE - ADDR_VIEW_CLIP;
+
+    struct StateGuard {
+        VirtualMemory *m;
+        bool active;
+        uint8_t saved[STATE_SIZE];
+
+        StateGuard(VirtualMemory *m, uint32_t addr, uint32_t size)
+            : m(m), active(overlaps(addr, size, ADDR_VIEW_CLIP, ADDR_CACHE)) {
+            if (active)
+                std::memcpy(saved, bytes(m) + ADDR_VIEW_CLIP, STATE_SIZE);
+        }
+
+        ~StateGuard() {
+            if (active)
+                std::memcpy(bytes(m) + ADDR_VIEW_CLIP, saved, STATE_SIZE);
+        }
+    };
+
+    static struct {
+        const VirtualMemory *m;
+        PageSet *pages;
+    } tracked[2];
+
+    void mem_track(const VirtualMemory *m, PageSet *pages) {
+        for (auto &t : tracked) {
+            if (t.m == m) {
+                t.pages = pages;
+                if (!pages)
+                    t.m = nullptr;
+                return;
+            }
+        }
+        if (!pages)
+            return;
+        for (auto &t : tracked) {
+            if (!t.m) {
+                t = {m, pages};
+                return;
+            }
+        }
+    }
+
+    void mem_mark(const VirtualMemory *m, uint32_t addr, uint32_t size) {
+        size = clamp_size(addr, size);
+        if (size == 0)
+            return;
+        for (const auto &t : tracked) {
+            if (t.m != m)
+                continue;
+            const auto last = (addr + size - 1) >> MEM_PAGE_SHIFT;
+            for (auto page = addr >> MEM_PAGE_SHIFT; page <= last; page++)
+                t.pages->set(page);
+            return;
+        }
+    }
+
+    void mem_mark(const VirtualMemory *m, const void *p, size_t size) {
+        const auto begin = bytes(m);
+        const auto at = static_cast<const uint8_t *>(p);
+        if (at < begin || at >= begin + ADDR_END)
+            return;
+        mem_mark(m, static_cast<uint32_t>(at - begin), static_cast<uint32_t>(size));
+    }
+
+    // 写入精灵图、地图或标志时使相应的缓存与索引失效
+    static inline void touch(VirtualMemory *m, uint32_t addr, uint32_t size) {
+        mem_mark(m, addr, size);
+        if (overlaps(addr, size, ADDR_SPRITE, ADDR_PALETTE))
+            gfx_map_invalidate(m);
+        if (overlaps(addr, size, ADDR_MAP, ADDR_PALETTE) ||
+            overlaps(addr, size, ADDR_FLAGS, ADDR_FLAGS + sizeof(VirtualMemory::flags)))
+            col_invalidate(m);
+    }
+
+    uint8_t mem_peek(const VirtualMemory *m, uint32_t addr) {
+        if (addr >= ADDR_END)
+            return 0;
+        return bytes(m)[addr];
+    }
+
+    void mem_poke(VirtualMemory *m, uint32_t addr, uint8_t value) {
+        if (addr >= ADDR_END || (addr >= ADDR_VIEW_CLIP && addr < ADDR_CACHE))
+            return;
+        bytes(m)[addr] = value;
+        touch(m, addr, 1);
+    }
+
+    uint32_t mem_peek4(const VirtualMemory *m, uint32_t addr) {
+        uint32_t value = 0;
+        const auto n = clamp_size(addr, 4);
+        for (uint32_t i = 0; i < n; i++)
+            value |= static_cast<uint32_t>(bytes(m)[addr + i]) << (i * 8);
+        return value;
+    }
+
+    void mem_poke4(VirtualMemory *m, uint32_t addr, uint32_t value) {
+        const auto n = clamp_size(addr, 4);
+        StateGuard guard(m, addr, n);
+        for (uint32_t i = 0; i < n; i++)
+            bytes(m)[addr + i] = static_cast<uint8_t>(value >> (i * 8));
+        touch(m, addr, n);
+    }
+
+    void mem_copy(VirtualMemory *m, uint32_t dst, uint32_t src, uint32_t size) {
+        size = std::min(clamp_size(dst, size), clamp_size(src, size));
+        if (size == 0)
+            return;
+        StateGuard guard(m, dst, size);
+        std::memmove(bytes(m) + dst, bytes(m) + src, size);
+        touch(m, dst, size);
+    }
+
+    void mem_set(VirtualMemory *m, uint32_t dst, uint8_t value, uint32_t size) {
+        size = clamp_size(dst, size);
+        if (size == 0)
+            return;
+        StateGuard guard(m, dst, size);
+        std::memset(bytes(m) + dst, value, size);
+        touch(m, dst, size);
+    }
+
+    void mem_touch(VirtualMemory *m, uint32_t addr, uint32_t size) {
+        touch(m, addr, clamp_size(addr, size));
+    }
+}
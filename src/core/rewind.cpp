@@ -0,0 +1,131 @@
+#include "core/rewind.h"
+#include "core/memory.h"
+#include "utils/delta.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace t8::utils;
+
+namespace t8::core {
+    static constexpr size_t SNAPSHOT_SIZE = sizeof(VirtualMemory);
+    static const size_t SCRATCH_SIZE = delta_bound(SNAPSHOT_SIZE);
+
+    static RewindFrame &frame_at(RewindState &s, size_t index) {
+        return s.frames[(s.head + index) % s.frames.size()];
+    }
+
+    static void evict_oldest(RewindState &s) {
+        s.head = (s.head + 1) % s.frames.size();
+        s.count -= 1;
+        if (s.count == 0)
+            s.write = 0;
+    }
+
+    // 在 arena 中找出一段连续空间, 必要时淘汰最旧的帧
+    static size_t reserve(RewindState &s, size_t size) {
+        const auto end = s.arena.size();
+
+        while (s.count > 0) {
+            const auto oldest = frame_at(s, 0).offset;
+
+            if (oldest < s.write) {
+                if (s.write + size <= end)
+                    return s.write;
+                if (size <= oldest)
+                    return 0;
+            } else if (s.write + size <= oldest) {
+                return s.write;
+            }
+
+            evict_oldest(s);
+        }
+
+        return 0;
+    }
+
+    bool rwd_init(RewindState &s, size_t arena_bytes, size_t max_frames) {
+        if (arena_bytes < SCRATCH_SIZE || max_frames == 0)
+            return false;
+
+        s.arena.assign(arena_bytes, 0);
+        s.scratch.assign(SCRATCH_SIZE, 0);
+        s.latest.assign(SNAPSHOT_SIZE, 0);
+        s.frames.assign(max_frames, {});
+        rwd_reset(s);
+        return true;
+    }
+
+    void rwd_reset(RewindState &s) {
+        s.has_latest = false;
+        s.head = 0;
+        s.count = 0;
+        s.write = 0;
+        s.encode_us = 0;
+        s.encode_us_max = 0;
+        s.encode_us_total = 0;
+        s.pushes = 0;
+    }
+
+    void rwd_push(RewindState &s, const VirtualMemory *m) {
+        if (s.arena.empty())
+            return;
+
+        const auto cur = reinterpret_cast<const uint8_t *>(m);
+
+        if (!s.has_latest) {
+            std::memcpy(s.latest.data(), cur, SNAPSHOT_SIZE);
+            s.has_latest = true;
+            return;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // 差分为 S(n) ^ S(n-1), 回退时作用于 S(n) 即得 S(n-1)
+        const auto size = delta_encode(s.scratch.data(), cur, s.latest.data(), SNAPSHOT_SIZE);
+
+        if (s.count == s.frames.size())
+            evict_oldest(s);
+
+        const auto offset = reserve(s, size);
+        std::memcpy(s.arena.data() + offset, s.scratch.data(), size);
+        std::memcpy(s.latest.data(), cur, SNAPSHOT_SIZE);
+
+        s.count += 1;
+        frame_at(s, s.count - 1) = {static_cast<uint32_t>(offset), static_cast<uint32_t>(size)};
+        s.write = offset + size;
+
+        s.encode_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        s.encode_us_max = std::max(s.encode_us_max, s.encode_us);
+        s.encode_us_total += s.encode_us;
+        s.pushes += 1;
+    }
+
+    bool rwd_step(RewindState &s, VirtualMemory *m) {
+        if (s.count == 0)
+            return false;
+
+        const auto frame = frame_at(s, s.count - 1);
+        delta_apply(s.latest.data(), s.arena.data() + frame.offset, frame.size, SNAPSHOT_SIZE);
+        std::memcpy(reinterpret_cast<uint8_t *>(m), s.latest.data(), SNAPSHOT_SIZE);
+        mem_touch(m, 0, ADDR_END);
+
+        s.count -= 1;
+        s.write = s.count ? frame.offset : 0;
+        return true;
+    }
+
+    size_t rwd_frames(const RewindState &s) {
+        return s.count;
+    }
+
+    size_t rwd_bytes(const RewindState &s) {
+        size_t total = 0;
+        for (size_t i = 0; i < s.count; i++)
+            total += s.frames[(s.head + i) % s.frames.size()].size;
+        return total;
+    }
+}
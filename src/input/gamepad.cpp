@@ -63,6 +63,13 @@ namespace t8::input
         }
     }
 
+    void g_set(GamepadState &s, uint8_t i, uint8_t btn)
+    {
+        if (i > 3)
+            return;
+        s.current[i].btn = btn;
+    }
+
     bool g_down(const GamepadState &s, uint8_t i, uint8_t btn)
     {
         if (i > 3)
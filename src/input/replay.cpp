@@ -0,0 +1,346 @@
+#include "input/replay.h"
+#include "utils/varint.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace t8::utils;
+
+namespace t8::input
+{
+    // 头部: 魔数与版本, 版本 2 起随后是 varint 随机数种子
+    static constexpr uint8_t STREAM_MAGIC[] = {'T', '8', 'I', 'R', 2};
+    static constexpr size_t STREAM_VERSION = sizeof(STREAM_MAGIC) - 1;
+
+    static constexpr uint8_t FIELD_GAMEPAD = 0x01;
+    static constexpr uint8_t FIELD_KEYBOARD = 0x02;
+    static constexpr uint8_t FIELD_REPEAT = 0x04;
+    static constexpr uint8_t FIELD_MOD = 0x08;
+    static constexpr uint8_t FIELD_MOTION = 0x10;
+    static constexpr uint8_t FIELD_WHEEL = 0x20;
+    static constexpr uint8_t FIELD_BUTTON = 0x40;
+    static constexpr uint8_t FIELD_TEXT = 0x80;
+
+    static uint64_t zigzag(int64_t v)
+    {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t v)
+    {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    static void put_varint(std::vector<uint8_t> &out, uint64_t v)
+    {
+        uint8_t buffer[VARINT_MAX_BYTES];
+        const auto n = varint_write(buffer, v);
+        out.insert(out.end(), buffer, buffer + n);
+    }
+
+    static bool get_varint(InputRecorder &r, uint64_t &v)
+    {
+        const auto begin = r.stream.data();
+        const auto n = varint_read(begin + r.cursor, begin + r.stream.size(), v);
+        r.cursor += n;
+        return n > 0;
+    }
+
+    static bool get_byte(InputRecorder &r, uint8_t &v)
+    {
+        if (r.cursor >= r.stream.size())
+            return false;
+        v = r.stream[r.cursor++];
+        return true;
+    }
+
+    // 写入与 base 不同的字节: [varint 字节掩码][变化的字节]
+    static bool put_bytes(std::vector<uint8_t> &out, const uint8_t *cur, uint8_t *base, size_t n)
+    {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < n; i++)
+            if (cur[i] != base[i])
+                mask |= 1ULL << i;
+
+        if (!mask)
+            return false;
+
+        put_varint(out, mask);
+        for (size_t i = 0; i < n; i++)
+            if (mask & (1ULL << i))
+                out.push_back(base[i] = cur[i]);
+        return true;
+    }
+
+    static bool get_bytes(InputRecorder &r, uint8_t *dst, size_t n)
+    {
+        uint64_t mask;
+        if (!get_varint(r, mask))
+            return false;
+        for (size_t i = 0; i < n; i++)
+            if ((mask & (1ULL << i)) && !get_byte(r, dst[i]))
+                return false;
+        return true;
+    }
+
+    static void record(InputRecorder &r, const GamepadState &g, const KeyboardState &k, const MouseState &m)
+    {
+        auto &body = r.body;
+        body.clear();
+        uint8_t fields = 0;
+
+        uint8_t pads[4];
+        for (auto i = 0; i < 4; i++)
+            pads[i] = g.current[i].btn;
+        if (put_bytes(body, pads, r.gamepad, 4))
+            fields |= FIELD_GAMEPAD;
+
+        if (put_bytes(body, k.current, r.keyboard, 32))
+            fields |= FIELD_KEYBOARD;
+
+        // 重复标记每 tick 清零, 因此直接与全零比较
+        uint8_t zero[32]{0};
+        if (put_bytes(body, k.repeated, zero, 32))
+            fields |= FIELD_REPEAT;
+
+        if (k.mod != r.mod)
+        {
+            body.push_back(r.mod = k.mod);
+            fields |= FIELD_MOD;
+        }
+
+        if (m.x != r.mouse_x || m.y != r.mouse_y)
+        {
+            put_varint(body, zigzag(m.x - r.mouse_x));
+            put_varint(body, zigzag(m.y - r.mouse_y));
+            r.mouse_x = m.x;
+            r.mouse_y = m.y;
+            fields |= FIELD_MOTION;
+        }
+
+        if (m.z != 0)
+        {
+            put_varint(body, zigzag(m.z));
+            fields |= FIELD_WHEEL;
+        }
+
+        if (m.current != r.mouse_button)
+        {
+            body.push_back(r.mouse_button = m.current);
+            fields |= FIELD_BUTTON;
+        }
+
+        if (r.text_count)
+        {
+            put_varint(body, r.text_count);
+            body.insert(body.end(), r.texts.begin(), r.texts.end());
+            r.texts.clear();
+            r.text_count = 0;
+            fields |= FIELD_TEXT;
+        }
+
+        if (!fields)
+            return;
+
+        put_varint(r.stream, r.tick - r.last_tick);
+        r.stream.push_back(fields);
+        r.stream.insert(r.stream.end(), body.begin(), body.end());
+        r.last_tick = r.tick;
+    }
+
+    static bool replay(InputRecorder &r, GamepadState &g, KeyboardState &k, MouseState &m, const ReplayTextFn &on_text)
+    {
+        uint8_t fields;
+        if (!get_byte(r, fields))
+            return false;
+
+        if (fields & FIELD_GAMEPAD)
+        {
+            if (!get_bytes(r, r.gamepad, 4))
+                return false;
+            for (auto i = 0; i < 4; i++)
+                g_set(g, i, r.gamepad[i]);
+        }
+
+        uint8_t keys[32];
+        std::memcpy(keys, r.keyboard, 32);
+        if ((fields & FIELD_KEYBOARD) && !get_bytes(r, r.keyboard, 32))
+            return false;
+
+        uint8_t repeated[32]{0};
+        if ((fields & FIELD_REPEAT) && !get_bytes(r, repeated, 32))
+            return false;
+
+        if ((fields & FIELD_MOD) && !get_byte(r, r.mod))
+            return false;
+
+        for (auto i = 0; i < 32; i++)
+        {
+            const auto changed = keys[i] ^ r.keyboard[i];
+            for (auto b = 0; b < 8; b++)
+            {
+                const auto bit = 1 << b;
+                if ((changed | repeated[i]) & bit)
+                    k_button(k, static_cast<uint8_t>(i * 8 + b), r.mod, repeated[i] & bit, r.keyboard[i] & bit);
+            }
+        }
+        k.mod = r.mod;
+
+        if (fields & FIELD_MOTION)
+        {
+            uint64_t dx, dy;
+            if (!get_varint(r, dx) || !get_varint(r, dy))
+                return false;
+            r.mouse_x += static_cast<int16_t>(unzigzag(dx));
+            r.mouse_y += static_cast<int16_t>(unzigzag(dy));
+            m_move(m, r.mouse_x, r.mouse_y);
+        }
+
+        if (fields & FIELD_WHEEL)
+        {
+            uint64_t z;
+            if (!get_varint(r, z))
+                return false;
+            m_wheel(m, static_cast<int16_t>(unzigzag(z)));
+        }
+
+        if (fields & FIELD_BUTTON)
+        {
+            const auto previous = r.mouse_button;
+            if (!get_byte(r, r.mouse_button))
+                return false;
+            for (auto b = 0; b < 8; b++)
+                if ((previous ^ r.mouse_button) & (1 << b))
+                    m_button(m, b + 1, r.mouse_button & (1 << b));
+        }
+
+        if (fields & FIELD_TEXT)
+        {
+            uint64_t count;
+            if (!get_varint(r, count))
+                return false;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                uint64_t size;
+                if (!get_varint(r, size) || r.cursor + size > r.stream.size())
+                    return false;
+                if (on_text)
+                    on_text(std::string_view(reinterpret_cast<const char *>(r.stream.data() + r.cursor), size));
+                r.cursor += size;
+            }
+        }
+
+        return true;
+    }
+
+    static void reset_tracking(InputRecorder &r)
+    {
+        r.cursor = 0;
+        r.tick = 0;
+        r.last_tick = 0;
+        r.next_tick = 0;
+        std::memset(r.gamepad, 0, sizeof(r.gamepad));
+        std::memset(r.keyboard, 0, sizeof(r.keyboard));
+        r.mod = 0;
+        r.mouse_x = r.mouse_y = 0;
+        r.mouse_button = 0;
+        r.texts.clear();
+        r.text_count = 0;
+    }
+
+    void rec_start(InputRecorder &r, uint64_t seed)
+    {
+        reset_tracking(r);
+        r.seed = seed;
+        r.stream.assign(std::begin(STREAM_MAGIC), std::end(STREAM_MAGIC));
+        put_varint(r.stream, seed);
+        r.mode = ReplayMode::Recording;
+    }
+
+    void rec_stop(InputRecorder &r)
+    {
+        r.mode = ReplayMode::Idle;
+        r.texts.clear();
+        r.text_count = 0;
+    }
+
+    bool rec_replay(InputRecorder &r, const std::vector<uint8_t> &stream)
+    {
+        if (stream.size() < sizeof(STREAM_MAGIC) ||
+            std::memcmp(stream.data(), STREAM_MAGIC, STREAM_VERSION) != 0)
+            return false;
+
+        // 版本 1 的流没有种子, 按 0 回放
+        const auto version = stream[STREAM_VERSION];
+        if (version != 1 && version != STREAM_MAGIC[STREAM_VERSION])
+            return false;
+
+        reset_tracking(r);
+        r.stream = stream;
+        r.cursor = sizeof(STREAM_MAGIC);
+        r.seed = 0;
+        if (version >= 2 && !get_varint(r, r.seed))
+            return false;
+        r.mode = ReplayMode::Replaying;
+
+        uint64_t delta;
+        if (!get_varint(r, delta))
+        {
+            r.mode = ReplayMode::Idle;
+            return true;
+        }
+        r.next_tick = delta;
+        return true;
+    }
+
+    bool rec_replaying(const InputRecorder &r)
+    {
+        return r.mode == ReplayMode::Replaying;
+    }
+
+    void rec_text(InputRecorder &r, std::string_view text)
+    {
+        if (r.mode != ReplayMode::Recording)
+            return;
+        put_varint(r.texts, text.size());
+        r.texts.insert(r.texts.end(), text.begin(), text.end());
+        r.text_count += 1;
+    }
+
+    void rec_tick(InputRecorder &r, GamepadState &g, KeyboardState &k, MouseState &m, const ReplayTextFn &on_text)
+    {
+        if (r.mode == ReplayMode::Recording)
+        {
+            record(r, g, k, m);
+        }
+        else if (r.mode == ReplayMode::Replaying && r.tick == r.next_tick)
+        {
+            uint64_t delta;
+            if (!replay(r, g, k, m, on_text) || !get_varint(r, delta))
+                r.mode = ReplayMode::Idle;
+            else
+                r.next_tick += delta;
+        }
+
+        r.tick += 1;
+    }
+
+    bool rec_save(const InputRecorder &r, const std::string &file_name)
+    {
+        std::ofstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char *>(r.stream.data()), r.stream.size());
+        return file.good();
+    }
+
+    bool rec_load(std::vector<uint8_t> &stream, const std::string &file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+        stream.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+}
@@ -1,16 +1,13 @@
 #include "scene/console.h"
+#include "core/cart.h"
 #include "core/context.h"
-#include "core/memory.h"
 #include "core/gfx.h"
-#include "input/gamepad.h"
 #include "input/keyboard.h"
-#include "input/mouse.h"
 #include "utils/algo.h"
 
 #include "constants.h"
 
 #include <algorithm>
-#include <cmath>
 
 using namespace t8::utils;
 using namespace t8::input;
@@ -18,10 +15,11 @@ using namespace t8::core;
 
 namespace t8::scene::console
 {
+    static ConsoleState state;
 
     void sanitize_cursor()
     {
-        state.cursor = std::clamp(state.cursor, 0ULL, state.input.size());
+        state.cursor = std::clamp(state.cursor, size_t{0}, state.input.size());
     }
 
     int measure_height(const size_t indent, const std::string &text)
@@ -46,21 +44,21 @@ namespace t8::scene::console
 
     void print(const std::string &text, bool prefix = false, uint8_t color = 1)
     {
-        if (state.records.empty())
+        auto &records = state.records;
+        int front_height = 0;
+
+        if (!records.empty())
         {
-            state.records.push_back({0,
-                                     measure_height(prefix ? 8 : 0, text),
-                                     prefix, color, text});
+            const auto &record = records[records.size() - 1];
+            front_height = record.front_height + record.height;
         }
-        else
-        {
-            const auto &record = state.records.back();
-            int front_height = record.front_height + record.height;
 
-            state.records.push_back({front_height,
-                                     measure_height(prefix ? 8 : 0, text),
-                                     prefix, color, text});
-        }
+        if (records.full())
+            records.pop();
+
+        records.push({front_height,
+                      measure_height(prefix ? 8 : 0, text),
+                      prefix, color, text});
     }
 
     void reset()
@@ -88,56 +86,7 @@ namespace t8::scene::console
         return true;
     }
 
-    bool load_cart(const std::string &file_name)
-    {
-        Zipper zip;
-        if (zip.open(file_name) != ZipError::Success)
-        {
-            return false;
-        }
-
-        if (zip.contains("script.lua"))
-        {
-            const auto &file = zip.file("script.lua");
-            ctx_script().resize(file.compressed_size);
-            std::memcpy(ctx_script().data(), file.data.data(), file.compressed_size);
-        }
-
-        if (zip.contains("font"))
-        {
-            const auto &file = zip.file("font");
-            const auto cpy_size = std::min(sizeof(Memory::custom_font), static_cast<uint64_t>(file.compressed_size));
-            std::memcpy(memory()->custom_font, file.data.data(), file.compressed_size);
-        }
-
-        if (zip.contains("map"))
-        {
-            const auto &file = zip.file("map");
-            const auto cpy_size = std::min(sizeof(Memory::map), static_cast<uint64_t>(file.compressed_size));
-            std::memcpy(memory()->map, file.data.data(), file.compressed_size);
-        }
-
-        if (zip.contains("sprite"))
-        {
-            const auto &file = zip.file("sprite");
-            const auto cpy_size = std::min(sizeof(Memory::sprite), static_cast<uint64_t>(file.compressed_size));
-            std::memcpy(memory()->sprite, file.data.data(), file.compressed_size);
-        }
-
-        return true;
-    }
-
-    bool save_cart(const std::string &file_name)
-    {
-        Zipper zip;
-        zip.add("script.lua", ctx_script());
-        zip.add("font", std::vector<uint8_t>(memory()->custom_font, memory()->custom_font + sizeof(Memory::custom_font)));
-        zip.add("map", std::vector<uint8_t>(memory()->map, memory()->map + sizeof(Memory::map)));
-        zip.add("sprite", std::vector<uint8_t>(memory()->sprite, memory()->sprite + sizeof(Memory::sprite)));
-        return zip.save(file_name) == ZipError::Success;
-    }
-
-    bool command()
+    bool command(AppContext &ctx)
     {
         if (state.input.empty())
             return false;
@@ -158,8 +107,9 @@ namespace t8::scene::console
             print("Commands:", false, 6);
             print("");
             print("load <filename>");
+            print("load <script.lua>");
             print("run");
-            print("save <filename>");
+            print("save <filename> [-c]");
             print("cls");
             print("");
             print("Press esc to editor view");
@@ -174,15 +124,17 @@ namespace t8::scene::console
 
         if (str_equals(payload[0], "load") && payload.size() > 1)
         {
-            if (!load_cart(payload[1]))
+            if (!cart_load(ctx, payload[1]))
                 print("Failed to load cart", false, 3);
             return true;
         }
 
         if (str_equals(payload[0], "save") && payload.size() > 1)
         {
-            if (!save_cart(payload[1]))
-                print("Failed to save cart", false, 3);
+            const auto compile = payload.size() > 2 && str_equals(payload[2], "-c");
+            std::string error;
+            if (!cart_save(ctx, payload[1], compile, error))
+                print(error.empty() ? "Failed to save cart" : error, false, 3);
             return true;
         }
 
@@ -190,7 +142,7 @@ namespace t8::scene::console
         {
             if (validate(payload, 1))
             {
-                ctx_signals().push({SIGNAL_SWAP_EXECUTOR});
+                ctx.signals.push({SIGNAL_SWAP_EXECUTOR, {}});
                 return true;
             }
         }
@@ -200,18 +152,18 @@ namespace t8::scene::console
         return true;
     }
 
-    void update()
+    void update(AppContext &ctx)
     {
-        if (keybd_pressed(SCANCODE_ESC))
+        if (k_pressed(ctx.keyboard, SCANCODE_ESC))
         {
-            ctx_signals().push({SIGNAL_SWAP_EDITOR});
+            ctx.signals.push({SIGNAL_SWAP_EDITOR, {}});
             return;
         }
 
-        if (!ctx_inputs().empty())
+        if (!ctx.inputs.empty())
         {
-            const auto text = ctx_inputs().front();
-            ctx_inputs().pop();
+            const auto text = ctx.inputs.front();
+            ctx.inputs.pop();
 
             for (const auto &ch : text)
                 if (!(ch & 0x80) && state.input.size() < 64)
@@ -224,11 +176,11 @@ namespace t8::scene::console
             return;
         }
 
-        if (keybd_pressed(SCANCODE_RETURN) ||
-            keybd_pressed(SCANCODE_ENTER))
+        if (k_pressed(ctx.keyboard, SCANCODE_RETURN) ||
+            k_pressed(ctx.keyboard, SCANCODE_ENTER))
         {
             print(state.input, true, 1);
-            if (command())
+            if (command(ctx))
                 if (state.history.empty() || state.history.back() != state.input)
                 {
                     state.history.push_back(state.input);
@@ -239,7 +191,7 @@ namespace t8::scene::console
             return;
         }
 
-        if (keybd_triggered(SCANCODE_BACKSPACE))
+        if (k_triggered(ctx.keyboard, SCANCODE_BACKSPACE))
         {
             if (!state.input.empty() && state.cursor > 0)
             {
@@ -248,7 +200,7 @@ namespace t8::scene::console
             }
             return;
         }
-        if (keybd_triggered(SCANCODE_DELETE))
+        if (k_triggered(ctx.keyboard, SCANCODE_DELETE))
         {
             if (!state.input.empty() && state.cursor < state.input.size())
             {
@@ -257,7 +209,7 @@ namespace t8::scene::console
             return;
         }
 
-        if (keybd_triggered(SCANCODE_LEFT))
+        if (k_triggered(ctx.keyboard, SCANCODE_LEFT))
         {
             if (state.cursor > 0)
                 state.cursor -= 1;
@@ -265,14 +217,14 @@ namespace t8::scene::console
             return;
         }
 
-        if (keybd_triggered(SCANCODE_RIGHT))
+        if (k_triggered(ctx.keyboard, SCANCODE_RIGHT))
         {
             state.cursor += 1;
             sanitize_cursor();
             return;
         }
 
-        if (keybd_triggered(SCANCODE_UP))
+        if (k_triggered(ctx.keyboard, SCANCODE_UP))
         {
             auto has_history = false;
             if (!state.use_history && state.history.size() > 0)
@@ -283,7 +235,7 @@ namespace t8::scene::console
             }
             else if (state.history_index > 0)
             {
-                state.history_index = std::clamp(state.history_index - 1, 0ULL, state.history.size() - 1);
+                state.history_index = std::clamp(state.history_index - 1, size_t{0}, state.history.size() - 1);
                 has_history = true;
             }
 
@@ -295,11 +247,11 @@ namespace t8::scene::console
             return;
         }
 
-        if (keybd_triggered(SCANCODE_DOWN))
+        if (k_triggered(ctx.keyboard, SCANCODE_DOWN))
         {
             if (state.use_history)
             {
-                state.history_index = std::clamp(state.history_index + 1, 0ULL, state.history.size());
+                state.history_index = std::clamp(state.history_index + 1, size_t{0}, state.history.size());
                 if (state.history_index == state.history.size())
                 {
                     state.input.clear();
@@ -320,53 +272,63 @@ namespace t8::scene::console
         }
     }
 
-    void draw()
+    void draw(AppContext &ctx)
     {
-        painter_clear(0);
+        const auto m = ctx.memory;
+        gfx_clear(m, 0);
 
-        auto &records = state.records;
+        const auto &records = state.records;
+        const auto count = records.size();
 
+        // 最早的记录被丢弃后 front_height 不再从 0 开始, 统一减去第一条的位置
+        auto base = 0;
         auto front_height = 0;
         auto input_height = measure_height(8, state.input);
 
-        if (state.records.size() > 0)
+        if (count > 0)
         {
-            const auto record = state.records.back();
-            front_height = record.front_height + record.height;
+            const auto &record = records[count - 1];
+            base = records[0].front_height;
+            front_height = record.front_height + record.height - base;
         }
 
         auto x = 0, y = std::min(0, 128 - front_height - input_height);
 
-        auto start = std::upper_bound(
-            state.records.begin(),
-            state.records.end(),
-            std::max(0, front_height - 128),
-            [](int value, const ConsoleRecord &r)
-            {
-                return value < r.front_height;
-            });
-
-        if (start != state.records.end())
+        // 从起点不低于屏幕上沿的最后一条记录开始绘制
+        const auto top = std::max(0, front_height - 128);
+        size_t start = 0;
+        while (start + 1 < count && records[start + 1].front_height - base <= top)
         {
-            start -= 1;
+            start += 1;
         }
 
-        if (start != state.records.end())
+        if (start < count)
         {
-            y += start->front_height;
+            y += records[start].front_height - base;
         }
 
-        for (auto it = start; it != state.records.end(); it += 1)
+        for (auto i = start; i < count; i += 1)
         {
+            const auto it = &records[i];
             if (it->prefix)
             {
-                painter_char('>', 0, y, it->color);
+                gfx_char(m, '>', 0, y, it->color);
                 x = 8;
             }
 
             for (const auto &ch : it->text)
             {
-                painter_char(ch, x, y, it->color);
+                // 与 measure_height 保持一致: 调用栈等多行文本按行显示
+                if (ch == '\r')
+                    continue;
+                if (ch == '\n')
+                {
+                    x = it->prefix ? 8 : 0;
+                    y += 8;
+                    continue;
+                }
+
+                gfx_char(m, ch == '\t' ? ' ' : ch, x, y, it->color);
                 x += 4;
 
                 if (x > 120)
@@ -380,21 +342,21 @@ namespace t8::scene::console
             y += 8;
         }
 
-        painter_char('>', 0, y);
+        gfx_char(m, '>', 0, y);
         x = 8;
 
-        for (auto i = 0ULL; i <= state.input.size(); i++)
+        for (size_t i = 0; i <= state.input.size(); i++)
         {
             if (state.cursor == i)
             {
-                if ((timer_ticks() >> 5) % 2)
+                if ((ctx.timer.ticks() >> 5) % 2)
                 {
-                    painter_rect(x, y, 1, 8, 3);
+                    gfx_rect(m, x, y, 1, 8, 3);
                 }
             }
             if (i < state.input.size())
             {
-                painter_char(state.input[i], x, y);
+                gfx_char(m, state.input[i], x, y);
                 x += 4;
                 if (x > 120)
                 {
@@ -405,10 +367,10 @@ namespace t8::scene::console
         }
     }
 
-    void enter()
+    void enter(AppContext &ctx)
     {
-        ctx_signals().push({SIGNAL_START_INPUT});
-        painter_reset();
+        ctx.signals.push({SIGNAL_START_INPUT, {}});
+        gfx_reset(ctx.memory);
 
         if (state.first_time)
         {
@@ -416,15 +378,15 @@ namespace t8::scene::console
             reset();
         }
 
-        timer_reset();
+        ctx.timer.reset();
     }
 
-    void leave()
+    void leave(AppContext &ctx)
     {
-        ctx_signals().push({SIGNAL_STOP_INPUT});
+        ctx.signals.push({SIGNAL_STOP_INPUT, {}});
     }
 
-    void print(const std::string &text, bool err)
+    void print(AppContext &ctx, const std::string &text, bool err)
     {
         if (err)
         {
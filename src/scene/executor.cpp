@@ -0,0 +1,1269 @@
+#include "scene/executor.h"
+#include "constants.h"
+#include "core/batch.h"
+#include "core/collision.h"
+#include "core/context.h"
+#include "core/gfx.h"
+#include "core/memory.h"
+#include "input/gamepad.h"
+#include "input/keyboard.h"
+#include "input/mouse.h"
+#include "script/chunk.h"
+#include "script/gc.h"
+#include "script/heap.h"
+#include "script/mathlib.h"
+#include "script/profiler.h"
+#include "script/reload.h"
+#include "script/scheduler.h"
+#include "script/watchdog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <new>
+#include <optional>
+#include <vector>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+using namespace t8::input;
+using namespace t8::core;
+using namespace t8::utils;
+using namespace t8::script;
+
+namespace t8::scene::executor
+{
+    struct ExecutorState
+    {
+        uint8_t select;
+        bool paused{false};
+    };
+
+    // 常驻的 VM, 标准库与 API 只注册一次; 每次运行使用新的全局环境 env
+    // 环境与回调函数以注册表引用持有, 未设置时为 LUA_NOREF
+    struct ScriptVM
+    {
+        // heap 必须先于 L 创建、晚于 L 关闭
+        ScriptHeap heap;
+        lua_State *L = nullptr;
+        AppContext *ctx = nullptr;
+
+        int env = LUA_NOREF;
+        int init = LUA_NOREF;
+        int update = LUA_NOREF;
+        int draw = LUA_NOREF;
+
+        GcProfile gc{GC_GENERATIONAL};
+        GcStats gc_stats;
+
+        Profiler profiler;
+        Watchdog watchdog;
+        Scheduler scheduler;
+
+        std::filesystem::file_time_type script_time;
+        uint64_t last_poll = 0;
+
+        // 本次运行已执行的 update 次数, 确定性运行时作为 time() 的值
+        uint64_t ticks = 0;
+        std::future<ReloadResult> reload;
+
+        ScriptVM() = default;
+        ScriptVM(const ScriptVM &) = delete;
+        ScriptVM &operator=(const ScriptVM &) = delete;
+
+        ~ScriptVM()
+        {
+            if (L)
+                lua_close(L);
+        }
+    };
+
+    static ExecutorState state;
+
+    static std::optional<ScriptVM> vm;
+
+    // 以下 API 只在 VM 中调用, 此时 vm->ctx 已由 enter 设置
+    static inline VirtualMemory *mem()
+    {
+        return vm->ctx->memory;
+    }
+
+    // API 全部注册为 lua_CFunction, 参数直接从栈上读取
+
+    static inline int arg_int(lua_State *L, int i)
+    {
+        int isnum;
+        const auto v = lua_tointegerx(L, i, &isnum);
+        if (isnum)
+            return static_cast<int>(v);
+        return static_cast<int>(std::floor(luaL_checknumber(L, i)));
+    }
+
+    static inline int opt_int(lua_State *L, int i, int def)
+    {
+        return lua_isnoneornil(L, i) ? def : arg_int(L, i);
+    }
+
+    // 地址与 32 位值, 超出 int 范围的数也按低 32 位取
+    static inline uint32_t arg_u32(lua_State *L, int i)
+    {
+        int isnum;
+        const auto v = lua_tointegerx(L, i, &isnum);
+        if (isnum)
+            return static_cast<uint32_t>(v);
+        return static_cast<uint32_t>(static_cast<lua_Integer>(std::floor(luaL_checknumber(L, i))));
+    }
+
+    static int api_pget(lua_State *L)
+    {
+        lua_pushinteger(L, gfx_pget(mem(), arg_int(L, 1), arg_int(L, 2)));
+        return 1;
+    }
+
+    static int api_pset(lua_State *L)
+    {
+        gfx_pset(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3));
+        return 0;
+    }
+
+    static int api_fget(lua_State *L)
+    {
+        lua_pushinteger(L, gfx_fget(mem(), arg_int(L, 1)));
+        return 1;
+    }
+
+    static int api_fset(lua_State *L)
+    {
+        gfx_fset(mem(), arg_int(L, 1), arg_int(L, 2));
+        return 0;
+    }
+
+    static int api_sget(lua_State *L)
+    {
+        lua_pushinteger(L, gfx_sget(mem(), arg_int(L, 1), arg_int(L, 2)));
+        return 1;
+    }
+
+    static int api_sset(lua_State *L)
+    {
+        gfx_sset(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3));
+        return 0;
+    }
+
+    static int api_mget(lua_State *L)
+    {
+        lua_pushinteger(L, gfx_mget(mem(), arg_int(L, 1), arg_int(L, 2)));
+        return 1;
+    }
+
+    static int api_mset(lua_State *L)
+    {
+        gfx_mset(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3));
+        return 0;
+    }
+
+    static int api_line(lua_State *L)
+    {
+        gfx_line(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5));
+        return 0;
+    }
+
+    static int api_cric(lua_State *L)
+    {
+        gfx_circ(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), lua_toboolean(L, 5));
+        return 0;
+    }
+
+    static int api_rect(lua_State *L)
+    {
+        gfx_rect(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5), lua_toboolean(L, 6));
+        return 0;
+    }
+
+    static int api_spr(lua_State *L)
+    {
+        const auto f = opt_int(L, 5, 0) & 0b11;
+        const auto r = opt_int(L, 6, 0) & 0b11;
+        gfx_spr(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), opt_int(L, 4, 1), f | (r << 2));
+        return 0;
+    }
+
+    static int api_btn(lua_State *L)
+    {
+        const auto i = static_cast<uint8_t>(arg_int(L, 1));
+        lua_pushboolean(L, g_down(vm->ctx->gamepad, i >> 3, 1 << (i & 0b111)));
+        return 1;
+    }
+
+    static int api_btnp(lua_State *L)
+    {
+        const auto i = static_cast<uint8_t>(arg_int(L, 1));
+        lua_pushboolean(L, g_pressed(vm->ctx->gamepad, i >> 3, 1 << (i & 0b111)));
+        return 1;
+    }
+
+    static int api_key(lua_State *L)
+    {
+        lua_pushboolean(L, k_down(vm->ctx->keyboard, static_cast<uint8_t>(arg_int(L, 1))));
+        return 1;
+    }
+
+    static int api_keyp(lua_State *L)
+    {
+        lua_pushboolean(L, k_pressed(vm->ctx->keyboard, static_cast<uint8_t>(arg_int(L, 1))));
+        return 1;
+    }
+
+    static int api_peek(lua_State *L)
+    {
+        lua_pushinteger(L, mem_peek(mem(), static_cast<uint32_t>(arg_int(L, 1))));
+        return 1;
+    }
+
+    static int api_poke(lua_State *L)
+    {
+        mem_poke(mem(), static_cast<uint32_t>(arg_int(L, 1)), arg_int(L, 2));
+        return 0;
+    }
+
+    // 文本直接读取 Lua 持有的字符串, 不复制到 std::string; 日志写入定长的信号队列
+    static int api_print(lua_State *L)
+    {
+        size_t n;
+        const auto s = luaL_checklstring(L, 1, &n);
+        auto x = arg_int(L, 2);
+        auto y = arg_int(L, 3);
+        const auto c = opt_int(L, 4, 1);
+        const auto w0 = opt_int(L, 5, 4);
+        const auto w1 = opt_int(L, 6, 8);
+
+        const auto sx = x;
+        for (const auto ch : std::string_view(s, n))
+        {
+            if (ch == '\n')
+            {
+                y += 8;
+                x = sx;
+            }
+            else if (ch != '\r')
+            {
+                gfx_char(mem(), static_cast<uint8_t>(ch), x, y, c, true);
+                x += (static_cast<uint8_t>(ch) < 0x80) ? w0 : w1;
+            }
+        }
+        return 0;
+    }
+
+    static int api_log(lua_State *L)
+    {
+        size_t n;
+        const auto s = luaL_checklstring(L, 1, &n);
+        vm->ctx->signals.push({SIGNAL_PRINT, SignalText(std::string_view(s, n))});
+        return 0;
+    }
+
+    static int api_spawn(lua_State *L)
+    {
+        return sch_spawn(L, vm->scheduler);
+    }
+
+    static int api_after(lua_State *L)
+    {
+        return sch_after(L, vm->scheduler);
+    }
+
+    static int api_every(lua_State *L)
+    {
+        return sch_every(L, vm->scheduler);
+    }
+
+    static int api_wait(lua_State *L)
+    {
+        return sch_wait(L);
+    }
+
+    // 批量绘制的参数可以是扁平的 Lua 数组, 也可以是 buffer() 创建的 userdata:
+    // 后者为 [size_t 长度][int16 数据], 绘制时直接读取, 无需转换
+
+    static constexpr const char *BUFFER_META = "t8.buffer";
+
+    static inline int16_t *buffer_data(size_t *p)
+    {
+        return reinterpret_cast<int16_t *>(p + 1);
+    }
+
+    static size_t *check_buffer(lua_State *L)
+    {
+        return static_cast<size_t *>(luaL_checkudata(L, 1, BUFFER_META));
+    }
+
+    static int api_buffer(lua_State *L)
+    {
+        const auto n = static_cast<size_t>(std::max(0, arg_int(L, 1)));
+        auto p = static_cast<size_t *>(lua_newuserdatauv(L, sizeof(size_t) + n * sizeof(int16_t), 0));
+        *p = n;
+        std::fill_n(buffer_data(p), n, 0);
+        luaL_setmetatable(L, BUFFER_META);
+        return 1;
+    }
+
+    static int buffer_index(lua_State *L)
+    {
+        const auto p = check_buffer(L);
+        const auto i = luaL_checkinteger(L, 2);
+        if (i < 1 || static_cast<size_t>(i) > *p)
+            lua_pushnil(L);
+        else
+            lua_pushinteger(L, buffer_data(p)[i - 1]);
+        return 1;
+    }
+
+    static int buffer_newindex(lua_State *L)
+    {
+        const auto p = check_buffer(L);
+        const auto i = luaL_checkinteger(L, 2);
+        luaL_argcheck(L, i >= 1 && static_cast<size_t>(i) <= *p, 2, "buffer index out of range");
+        buffer_data(p)[i - 1] = static_cast<int16_t>(arg_int(L, 3));
+        return 0;
+    }
+
+    static int buffer_len(lua_State *L)
+    {
+        lua_pushinteger(L, static_cast<lua_Integer>(*check_buffer(L)));
+        return 1;
+    }
+
+    // 取出至多 limit 组、每组 stride 个数的参数; 数组中的数值转换到复用的暂存区
+    static const int16_t *batch_args(lua_State *L, size_t stride, size_t &count)
+    {
+        static std::vector<int16_t> scratch;
+
+        const auto limit = opt_int(L, 2, -1);
+
+        if (auto p = static_cast<size_t *>(luaL_testudata(L, 1, BUFFER_META)))
+        {
+            count = *p / stride;
+            if (limit >= 0)
+                count = std::min(count, static_cast<size_t>(limit));
+            return buffer_data(p);
+        }
+
+        luaL_checktype(L, 1, LUA_TTABLE);
+        count = lua_rawlen(L, 1) / stride;
+        if (limit >= 0)
+            count = std::min(count, static_cast<size_t>(limit));
+
+        const auto n = count * stride;
+        scratch.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            lua_rawgeti(L, 1, static_cast<lua_Integer>(i + 1));
+            int isnum;
+            auto v = lua_tointegerx(L, -1, &isnum);
+            if (!isnum)
+                v = static_cast<lua_Integer>(std::floor(lua_tonumber(L, -1)));
+            scratch[i] = static_cast<int16_t>(v);
+            lua_pop(L, 1);
+        }
+        return scratch.data();
+    }
+
+    static int api_psetn(lua_State *L)
+    {
+        size_t count;
+        const auto xyc = batch_args(L, 3, count);
+        bat_points(mem(), xyc, count);
+        return 0;
+    }
+
+    static int api_sprn(lua_State *L)
+    {
+        size_t count;
+        const auto quads = batch_args(L, 4, count);
+        bat_sprites(mem(), quads, count);
+        return 0;
+    }
+
+    // batch() 返回的命令缓冲是 userdata, 追加命令直接写入 DrawBatch 的紧凑命令数组
+
+    static constexpr const char *BATCH_META = "t8.batch";
+
+    static inline DrawBatch &check_batch(lua_State *L)
+    {
+        return *static_cast<DrawBatch *>(luaL_checkudata(L, 1, BATCH_META));
+    }
+
+    static int api_batch(lua_State *L)
+    {
+        const auto ordered = lua_isnoneornil(L, 1) || lua_toboolean(L, 1);
+        auto b = new (lua_newuserdatauv(L, sizeof(DrawBatch), 0)) DrawBatch();
+        b->ordered = ordered;
+        luaL_setmetatable(L, BATCH_META);
+        return 1;
+    }
+
+    static int batch_gc(lua_State *L)
+    {
+        check_batch(L).~DrawBatch();
+        return 0;
+    }
+
+    static int batch_len(lua_State *L)
+    {
+        lua_pushinteger(L, static_cast<lua_Integer>(check_batch(L).cmds.size()));
+        return 1;
+    }
+
+    static int batch_pset(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_PSET, arg_int(L, 4), arg_int(L, 2), arg_int(L, 3));
+        return 0;
+    }
+
+    static int batch_line(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_LINE, arg_int(L, 6), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5));
+        return 0;
+    }
+
+    static int batch_rect(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_RECT, arg_int(L, 6), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5));
+        return 0;
+    }
+
+    static int batch_rectfill(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_RECTFILL, arg_int(L, 6), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5));
+        return 0;
+    }
+
+    static int batch_cric(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_CIRC, arg_int(L, 5), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4));
+        return 0;
+    }
+
+    static int batch_cricfill(lua_State *L)
+    {
+        bat_push(check_batch(L), DRAW_CIRCFILL, arg_int(L, 5), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4));
+        return 0;
+    }
+
+    static int batch_spr(lua_State *L)
+    {
+        const auto f = opt_int(L, 6, 0) & 0b11;
+        const auto r = opt_int(L, 7, 0) & 0b11;
+        bat_push(check_batch(L), DRAW_SPR, arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), opt_int(L, 5, 1), f | (r << 2));
+        return 0;
+    }
+
+    static int batch_print(lua_State *L)
+    {
+        auto &b = check_batch(L);
+        size_t n;
+        const auto s = luaL_checklstring(L, 2, &n);
+        bat_text(b, std::string_view(s, n), arg_int(L, 3), arg_int(L, 4), opt_int(L, 5, 1));
+        return 0;
+    }
+
+    static int batch_flush(lua_State *L)
+    {
+        lua_pushinteger(L, static_cast<lua_Integer>(bat_flush(mem(), check_batch(L))));
+        return 1;
+    }
+
+    static int batch_clear(lua_State *L)
+    {
+        bat_clear(check_batch(L));
+        return 0;
+    }
+
+    static const luaL_Reg batch_methods[] = {
+        {"pset", batch_pset},
+        {"line", batch_line},
+        {"rect", batch_rect},
+        {"rectfill", batch_rectfill},
+        {"cric", batch_cric},
+        {"cricfill", batch_cricfill},
+        {"spr", batch_spr},
+        {"print", batch_print},
+        {"flush", batch_flush},
+        {"clear", batch_clear},
+        {nullptr, nullptr},
+    };
+
+    static const luaL_Reg batch_meta[] = {
+        {"__gc", batch_gc},
+        {"__len", batch_len},
+        {nullptr, nullptr},
+    };
+
+    static const luaL_Reg buffer_meta[] = {
+        {"__index", buffer_index},
+        {"__newindex", buffer_newindex},
+        {"__len", buffer_len},
+        {nullptr, nullptr},
+    };
+
+    static int api_clip(lua_State *L)
+    {
+        if (lua_gettop(L) == 0)
+            gfx_clip(mem());
+        else
+            gfx_clip(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4));
+        return 0;
+    }
+
+    static int api_pal(lua_State *L)
+    {
+        const auto n = static_cast<uint8_t>(arg_int(L, 1));
+        if (lua_gettop(L) >= 2)
+        {
+            gfx_pal(mem(), n, static_cast<uint8_t>(arg_int(L, 2)));
+            return 0;
+        }
+        lua_pushinteger(L, gfx_pal(mem(), n));
+        return 1;
+    }
+
+    static int api_palt(lua_State *L)
+    {
+        if (lua_gettop(L) >= 2)
+            gfx_palt(mem(), static_cast<uint8_t>(arg_int(L, 1)), static_cast<bool>(lua_toboolean(L, 2)));
+        else
+            gfx_palt(mem(), static_cast<uint16_t>(opt_int(L, 1, 0)));
+        return 0;
+    }
+
+    static int api_cls(lua_State *L)
+    {
+        gfx_clear(mem(), static_cast<uint8_t>(opt_int(L, 1, 0)));
+        return 0;
+    }
+
+    static int api_mouse(lua_State *L)
+    {
+        const auto &m = vm->ctx->mouse;
+        lua_pushinteger(L, m.x);
+        lua_pushinteger(L, m.y);
+        lua_pushinteger(L, m.z);
+        lua_pushinteger(L, m.current);
+        return 4;
+    }
+
+    static int api_time(lua_State *L)
+    {
+        auto &ctx = *vm->ctx;
+        const auto ticks = ctx.deterministic ? vm->ticks : ctx.timer.ticks();
+        lua_pushinteger(L, static_cast<lua_Integer>(ticks));
+        return 1;
+    }
+
+    static int api_tstamp(lua_State *L)
+    {
+        lua_pushinteger(L, static_cast<lua_Integer>(std::time(nullptr)));
+        return 1;
+    }
+
+    static int api_gcprofile(lua_State *L)
+    {
+        size_t n;
+        const auto name = luaL_checklstring(L, 1, &n);
+        if (!gc_profile(std::string_view(name, n), vm->gc))
+        {
+            lua_pushboolean(L, false);
+            return 1;
+        }
+        if (!lua_isnoneornil(L, 2))
+            vm->gc.budget_us = arg_u32(L, 2);
+        gc_apply(L, vm->gc);
+        lua_pushboolean(L, true);
+        return 1;
+    }
+
+    static int api_gcstat(lua_State *L)
+    {
+        const auto &s = vm->gc_stats;
+        lua_pushinteger(L, static_cast<lua_Integer>(s.heap_bytes));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.step_us));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.step_us_max));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.cycles));
+        return 4;
+    }
+
+    static int api_memlimit(lua_State *L)
+    {
+        const auto bytes = std::max<lua_Integer>(luaL_checkinteger(L, 1), 1);
+        vm->heap.limit = std::min(static_cast<size_t>(bytes), HEAP_DEFAULT_LIMIT);
+        return 0;
+    }
+
+    static int api_memstat(lua_State *L)
+    {
+        const auto &s = vm->heap.stats;
+        lua_pushinteger(L, static_cast<lua_Integer>(s.live));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.peak));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.frame_allocs));
+        lua_pushinteger(L, static_cast<lua_Integer>(s.frame_frees));
+        return 4;
+    }
+
+    static int api_budget(lua_State *L)
+    {
+        vm->watchdog.budget_ms = arg_u32(L, 1);
+        vm->watchdog.budget_instructions = static_cast<uint64_t>(std::max<lua_Integer>(luaL_optinteger(L, 2, 0), 0));
+        return 0;
+    }
+
+    static int api_map(lua_State *L)
+    {
+        gfx_map(
+            mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5), arg_int(L, 6),
+            opt_int(L, 7, 1), static_cast<uint8_t>(opt_int(L, 8, 0xFF)));
+        return 0;
+    }
+
+    static int api_mapcache(lua_State *L)
+    {
+        gfx_map_cache(lua_toboolean(L, 1));
+        return 0;
+    }
+
+    static int api_fany(lua_State *L)
+    {
+        lua_pushboolean(L, col_any(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5)));
+        return 1;
+    }
+
+    static int api_fray(lua_State *L)
+    {
+        lua_pushinteger(L, col_ray(mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), opt_int(L, 5, 128)));
+        return 1;
+    }
+
+    static int api_fsweep(lua_State *L)
+    {
+        const auto r = col_sweep(
+            mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3),
+            arg_int(L, 4), arg_int(L, 5), arg_int(L, 6), arg_int(L, 7));
+        lua_pushinteger(L, r.x);
+        lua_pushinteger(L, r.y);
+        lua_pushboolean(L, r.hit_x);
+        lua_pushboolean(L, r.hit_y);
+        return 4;
+    }
+
+    static int api_target(lua_State *L)
+    {
+        if (lua_gettop(L) == 0)
+        {
+            lua_pushinteger(L, mem()->draw_target);
+            return 1;
+        }
+        lua_pushboolean(L, gfx_target(mem(), static_cast<uint8_t>(arg_int(L, 1))));
+        return 1;
+    }
+
+    static int api_blit(lua_State *L)
+    {
+        gfx_blit(
+            mem(), arg_int(L, 1), arg_int(L, 2), arg_int(L, 3), arg_int(L, 4), arg_int(L, 5),
+            arg_int(L, 6), arg_int(L, 7), arg_int(L, 8), opt_int(L, 9, -1));
+        return 0;
+    }
+
+    static int api_peek4(lua_State *L)
+    {
+        lua_pushinteger(L, mem_peek4(mem(), arg_u32(L, 1)));
+        return 1;
+    }
+
+    static int api_poke4(lua_State *L)
+    {
+        mem_poke4(mem(), arg_u32(L, 1), arg_u32(L, 2));
+        return 0;
+    }
+
+    static int api_memcpy(lua_State *L)
+    {
+        mem_copy(mem(), arg_u32(L, 1), arg_u32(L, 2), arg_u32(L, 3));
+        return 0;
+    }
+
+    static int api_memset(lua_State *L)
+    {
+        mem_set(mem(), arg_u32(L, 1), static_cast<uint8_t>(arg_int(L, 2)), arg_u32(L, 3));
+        return 0;
+    }
+
+    static const luaL_Reg api[] = {
+        {"pget", api_pget},
+        {"pset", api_pset},
+        {"fget", api_fget},
+        {"fset", api_fset},
+        {"sget", api_sget},
+        {"sset", api_sset},
+        {"mget", api_mget},
+        {"mset", api_mset},
+        {"line", api_line},
+        {"cric", api_cric},
+        {"rect", api_rect},
+        {"spr", api_spr},
+        {"btn", api_btn},
+        {"btnp", api_btnp},
+        {"key", api_key},
+        {"keyp", api_keyp},
+        {"peek", api_peek},
+        {"poke", api_poke},
+        {"print", api_print},
+        {"log", api_log},
+        {"psetn", api_psetn},
+        {"sprn", api_sprn},
+        {"buffer", api_buffer},
+        {"batch", api_batch},
+        {"spawn", api_spawn},
+        {"after", api_after},
+        {"every", api_every},
+        {"wait", api_wait},
+        {"clip", api_clip},
+        {"pal", api_pal},
+        {"palt", api_palt},
+        {"cls", api_cls},
+        {"mouse", api_mouse},
+        {"time", api_time},
+        {"tstamp", api_tstamp},
+        {"gcprofile", api_gcprofile},
+        {"gcstat", api_gcstat},
+        {"memlimit", api_memlimit},
+        {"memstat", api_memstat},
+        {"budget", api_budget},
+        {"map", api_map},
+        {"mapcache", api_mapcache},
+        {"fany", api_fany},
+        {"fray", api_fray},
+        {"fsweep", api_fsweep},
+        {"target", api_target},
+        {"blit", api_blit},
+        {"peek4", api_peek4},
+        {"poke4", api_poke4},
+        {"memcpy", api_memcpy},
+        {"memset", api_memset},
+    };
+
+
+    static void setup_api(lua_State *L)
+    {
+        for (const auto &reg : api)
+            lua_register(L, reg.name, reg.func);
+
+        luaL_newmetatable(L, BUFFER_META);
+        luaL_setfuncs(L, buffer_meta, 0);
+        lua_pop(L, 1);
+
+        luaL_newmetatable(L, BATCH_META);
+        luaL_setfuncs(L, batch_meta, 0);
+        lua_newtable(L);
+        luaL_setfuncs(L, batch_methods, 0);
+        lua_setfield(L, -2, "__index");
+        lua_pop(L, 1);
+    }
+
+    static void unref(int &ref)
+    {
+        luaL_unref(vm->L, LUA_REGISTRYINDEX, ref);
+        ref = LUA_NOREF;
+    }
+
+    // 取出运行环境中名为 name 的函数并持有引用, 不是函数时返回 LUA_NOREF
+    static int env_function(const char *name)
+    {
+        auto L = vm->L;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, vm->env);
+        lua_getfield(L, -1, name);
+        lua_remove(L, -2);
+        if (!lua_isfunction(L, -1))
+        {
+            lua_pop(L, 1);
+            return LUA_NOREF;
+        }
+        return luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    static void bind_callbacks()
+    {
+        unref(vm->init);
+        unref(vm->update);
+        unref(vm->draw);
+        vm->init = env_function("init");
+        vm->update = env_function("update");
+        vm->draw = env_function("draw");
+    }
+
+    // 性能分析与看门狗共用同一个计数钩子
+    static void vm_hook(lua_State *L, lua_Debug *)
+    {
+        prof_sample(vm->profiler, L);
+
+        if (wd_check(vm->watchdog, lua_gethookcount(L)))
+        {
+            // 脚本中的 pcall 会捕获该错误, 但之后的每次检查都会再次触发, 直到回调返回
+            lua_pushfstring(L, "%s() exceeded its budget", vm->watchdog.callback);
+            lua_error(L);
+        }
+    }
+
+    static void setup_hook()
+    {
+        const auto count = vm->profiler.running ? vm->profiler.interval : WD_INTERVAL;
+        lua_sethook(vm->L, vm_hook, LUA_MASKCOUNT, count);
+    }
+
+    static int traceback(lua_State *L)
+    {
+        luaL_traceback(L, L, lua_tostring(L, 1), 1);
+        return 1;
+    }
+
+    // 错误信息的第一行随 SIGNAL_EXCEPTION 发出, 调用栈其余各行各占一个 SIGNAL_TRACE
+    static void push_error(AppContext &ctx, const char *message)
+    {
+        std::string_view text = message ? message : "(error object is not a string)";
+        auto type = SIGNAL_EXCEPTION;
+        for (;;)
+        {
+            const auto end = text.find('\n');
+            ctx.signals.push({type, SignalText(text.substr(0, end))});
+            if (end == std::string_view::npos)
+                break;
+            text.remove_prefix(end + 1);
+            type = SIGNAL_TRACE;
+        }
+    }
+
+    // 调用栈顶的函数, 出错时发出附带调用栈的 SIGNAL_EXCEPTION
+    static bool guarded_pcall(const char *name)
+    {
+        auto L = vm->L;
+        lua_pushcfunction(L, traceback);
+        lua_insert(L, -2);
+
+        wd_arm(vm->watchdog, name);
+        const auto status = lua_pcall(L, 0, 0, -2);
+        wd_disarm(vm->watchdog);
+
+        if (status != LUA_OK)
+        {
+            push_error(*vm->ctx, lua_tostring(L, -1));
+            lua_pop(L, 2);
+            return false;
+        }
+
+        lua_pop(L, 1);
+        return true;
+    }
+
+    static bool guarded_call(int ref, const char *name)
+    {
+        if (ref == LUA_NOREF)
+            return true;
+        lua_rawgeti(vm->L, LUA_REGISTRYINDEX, ref);
+        return guarded_pcall(name);
+    }
+
+    // 停止时写出折叠栈文件, 并在控制台输出自身耗时前 10 的函数
+    static void toggle_profiler()
+    {
+        auto &p = vm->profiler;
+        auto &signals = vm->ctx->signals;
+
+        if (!p.running)
+        {
+            prof_start(p);
+            setup_hook();
+            signals.push({SIGNAL_REPORT, "profiler started"});
+            return;
+        }
+
+        prof_stop(p);
+        setup_hook();
+
+        const std::string file_name = "t8y.folded";
+        const auto saved = prof_save(p, file_name);
+        signals.push({SIGNAL_REPORT, std::to_string(p.count) + " samples" + (saved ? " -> " + file_name : "")});
+
+        for (const auto &e : prof_top(p, 10))
+        {
+            char line[96];
+            std::snprintf(
+                line, sizeof(line), "%5.1f%% %5.1f%% %s",
+                100.0 * e.self / p.count, 100.0 * e.inclusive / p.count, e.func->label.c_str());
+            signals.push({SIGNAL_REPORT, line});
+        }
+    }
+
+    // 每秒检查一次脚本文件, 变化后在后台编译, 完成后换入新的函数定义
+    static void poll_reload()
+    {
+        auto &ctx = *vm->ctx;
+
+        if (vm->reload.valid())
+        {
+            if (vm->reload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return;
+
+            auto result = vm->reload.get();
+            std::string error = result.error;
+            if (result.ok)
+            {
+                // 新代码块的顶层代码与回调一样受看门狗限制
+                auto L = vm->L;
+                lua_rawgeti(L, LUA_REGISTRYINDEX, vm->env);
+                wd_arm(vm->watchdog, "reload");
+                result.ok = rld_apply(L, -1, result.bytecode, error);
+                wd_disarm(vm->watchdog);
+                lua_pop(L, 1);
+            }
+
+            if (!result.ok)
+            {
+                ctx.signals.push({SIGNAL_REPORT, "reload failed: " + error});
+                return;
+            }
+
+            ctx.script = std::move(result.source);
+            ctx.bytecode.clear();
+            bind_callbacks();
+
+            auto reload = env_function("reload");
+            const auto ok = guarded_call(reload, "reload");
+            unref(reload);
+            if (ok)
+                ctx.signals.push({SIGNAL_REPORT, "script reloaded"});
+            return;
+        }
+
+        // 只有单独的 .lua 脚本有 script_path, zip 卡带不会重载;
+        // ticks 随真实时间推进, 每帧不一定落在 64 的倍数上, 因此按间隔判断
+        const auto &path = ctx.script_path;
+        const auto now = ctx.timer.ticks();
+        if (path.empty() || now - vm->last_poll < 64)
+            return;
+        vm->last_poll = now;
+
+        std::error_code ec;
+        const auto time = std::filesystem::last_write_time(path, ec);
+        if (ec || time == vm->script_time)
+            return;
+        vm->script_time = time;
+
+        std::ifstream file(path, std::ios::binary);
+        std::string source(std::istreambuf_iterator<char>(file), {});
+        if (file && source != ctx.script)
+            vm->reload = rld_compile(std::move(source));
+    }
+
+    static void step(AppContext &ctx);
+
+    // time() 在 update 中为之前的 tick 数, 在随后的 draw 中已加一
+    void update(AppContext &ctx)
+    {
+        step(ctx);
+        vm->ticks += 1;
+    }
+
+    static void step(AppContext &ctx)
+    {
+        poll_reload();
+
+        if (k_pressed(ctx.keyboard, SCANCODE_PROFILE))
+        {
+            toggle_profiler();
+        }
+
+        heap_frame(vm->heap);
+
+        if (k_pressed(ctx.keyboard, 41) && !state.paused)
+        {
+            state.paused = true;
+            state.select = 0;
+        }
+
+        if (state.paused)
+        {
+            if (k_pressed(ctx.keyboard, 82) && state.select)
+            {
+                state.select -= 1;
+            }
+            if (k_pressed(ctx.keyboard, 81))
+            {
+                state.select = std::clamp(state.select + 1, 0, 1);
+            }
+            if (k_pressed(ctx.keyboard, 40) || k_pressed(ctx.keyboard, 88))
+            {
+                state.paused = false;
+                if (state.select == 1)
+                {
+                    ctx.signals.push({SIGNAL_SWAP_CONSOLE, {}});
+                }
+            }
+        }
+
+        if (!state.paused)
+        {
+            if (!guarded_call(vm->update, "update"))
+                return;
+
+            // 在 update 之后唤醒到期的协程与周期回调
+            std::string error;
+            wd_arm(vm->watchdog, "scheduler");
+            const auto ok = sch_run(vm->L, vm->scheduler, error);
+            wd_disarm(vm->watchdog);
+            if (!ok)
+            {
+                push_error(ctx, error.c_str());
+                return;
+            }
+        }
+    }
+
+    void draw(AppContext &ctx)
+    {
+        const auto m = ctx.memory;
+        gfx_clear(m, 0);
+
+        if (!guarded_call(vm->draw, "draw"))
+            return;
+
+        gc_idle(vm->L, vm->gc, vm->gc_stats);
+
+        if (state.paused)
+        {
+            static const std::string menu[] = {"RESUME", "EXIT"};
+
+            for (auto i = 0; i < 2; i++)
+            {
+                auto x = 1;
+                auto y = 110 + 9 * i;
+
+                for (const auto &ch : menu[i])
+                {
+                    if (state.select == i)
+                    {
+                        gfx_char(m, ch, x, y, 3);
+                    }
+                    else
+                    {
+                        gfx_char(m, ch, x, y, 1);
+                    }
+                    x += 4;
+                }
+            }
+        }
+    }
+
+    // 开启字节码加载且卡带附带的字节码与当前源码一致时直接加载, 否则只接受源码
+    static int load_script(lua_State *L, const AppContext &ctx)
+    {
+        if (ctx.load_bytecode && chunk_matches(ctx.bytecode, ctx.script))
+        {
+            const auto code = chunk_code(ctx.bytecode);
+            if (luaL_loadbufferx(L, code.data(), code.size(), "=script", "b") == LUA_OK)
+                return LUA_OK;
+            lua_pop(L, 1);
+        }
+        return luaL_loadbufferx(L, ctx.script.data(), ctx.script.size(), "=script", "t");
+    }
+
+    static void setup_vm()
+    {
+        vm.emplace();
+        auto L = vm->L = lua_newstate(heap_alloc, &vm->heap);
+        luaL_requiref(L, "_G", luaopen_base, 1);
+        luaL_requiref(L, "math", luaopen_math, 1);
+        luaL_requiref(L, "table", luaopen_table, 1);
+        luaL_requiref(L, "t8math", luaopen_t8math, 1);
+        lua_pop(L, 4);
+        setup_api(L);
+    }
+
+    // load/loadfile 未给出 env 参数时默认使用共享全局表, 这里改为本次运行的环境;
+    // 上值: 原函数, 环境表, env 参数的位置. 显式传入的 env (包括 nil) 保持不变
+    static int env_loader(lua_State *L)
+    {
+        const auto slot = static_cast<int>(lua_tointeger(L, lua_upvalueindex(3)));
+        if (lua_gettop(L) < slot)
+        {
+            lua_settop(L, slot - 1);
+            lua_pushvalue(L, lua_upvalueindex(2));
+        }
+        lua_pushvalue(L, lua_upvalueindex(1));
+        lua_insert(L, 1);
+        lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+        return lua_gettop(L);
+    }
+
+    static void wrap_loader(lua_State *L, int env, const char *name, int slot)
+    {
+        lua_getglobal(L, name);
+        if (!lua_isfunction(L, -1))
+        {
+            lua_pop(L, 1);
+            return;
+        }
+        lua_pushvalue(L, env);
+        lua_pushinteger(L, slot);
+        lua_pushcclosure(L, env_loader, 3);
+        lua_setfield(L, env, name);
+    }
+
+    // 新的全局环境: 读取未定义的名字时回退到共享的全局表,
+    // 库表按层复制一份, 使脚本对 math 等的修改不会影响下一次运行
+    static void reset_run()
+    {
+        auto L = vm->L;
+
+        unref(vm->env);
+        unref(vm->init);
+        unref(vm->update);
+        unref(vm->draw);
+
+        lua_newtable(L);
+        const auto env = lua_gettop(L);
+        lua_newtable(L);
+        lua_pushglobaltable(L);
+        lua_setfield(L, -2, "__index");
+        lua_setmetatable(L, env);
+
+        lua_pushglobaltable(L);
+        const auto globals = lua_gettop(L);
+        lua_pushnil(L);
+        while (lua_next(L, globals))
+        {
+            const auto is_g = lua_type(L, -2) == LUA_TSTRING && std::strcmp(lua_tostring(L, -2), "_G") == 0;
+            if (lua_istable(L, -1) && !is_g)
+            {
+                const auto src = lua_gettop(L);
+                lua_newtable(L);
+                const auto copy = lua_gettop(L);
+                lua_pushnil(L);
+                while (lua_next(L, src))
+                {
+                    lua_pushvalue(L, -2);
+                    lua_insert(L, -2);
+                    lua_rawset(L, copy);
+                }
+                lua_pushvalue(L, src - 1);
+                lua_insert(L, -2);
+                lua_rawset(L, env);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+
+        wrap_loader(L, env, "load", 4);
+        wrap_loader(L, env, "loadfile", 3);
+
+        lua_pushvalue(L, env);
+        lua_setfield(L, env, "_G");
+        vm->env = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        sch_clear(L, vm->scheduler);
+
+        vm->gc = GC_GENERATIONAL;
+        vm->gc_stats = {};
+        gc_apply(L, vm->gc);
+
+        vm->heap.limit = HEAP_DEFAULT_LIMIT;
+        vm->heap.stats.peak = vm->heap.stats.live;
+
+        prof_stop(vm->profiler);
+        vm->watchdog = {};
+        setup_hook();
+
+        // 上一次运行未完成的重载结果作废 (析构会等待后台编译结束)
+        vm->reload = {};
+        vm->last_poll = 0;
+        vm->ticks = 0;
+
+        const auto &path = vm->ctx->script_path;
+        std::error_code ec;
+        vm->script_time = path.empty()
+                              ? std::filesystem::file_time_type()
+                              : std::filesystem::last_write_time(path, ec);
+    }
+
+    void enter(AppContext &ctx)
+    {
+        ctx_swap_memory(&ctx, true);
+
+        if (!vm)
+            setup_vm();
+        vm->ctx = &ctx;
+        reset_run();
+
+        auto L = vm->L;
+        if (ctx.deterministic)
+        {
+            lua_getglobal(L, "math");
+            lua_getfield(L, -1, "randomseed");
+            lua_pushinteger(L, static_cast<lua_Integer>(ctx.seed));
+            lua_call(L, 1, 0);
+            lua_pop(L, 1);
+        }
+        if (load_script(L, ctx) != LUA_OK)
+        {
+            push_error(ctx, lua_tostring(L, -1));
+            lua_pop(L, 1);
+            return;
+        }
+
+        // 主代码块的第一个上值即 _ENV, 字节码去除了上值名因此按序号设置
+        lua_rawgeti(L, LUA_REGISTRYINDEX, vm->env);
+        if (!lua_setupvalue(L, -2, 1))
+            lua_pop(L, 1);
+
+        if (!guarded_pcall("main"))
+            return;
+
+        bind_callbacks();
+
+        if (!guarded_call(vm->init, "init"))
+            return;
+
+        gfx_clear(ctx.memory, 0);
+
+        ctx.signals.push({SIGNAL_STOP_INPUT, {}});
+
+        ctx.timer.reset();
+    }
+
+    void leave(AppContext &ctx)
+    {
+        // 上一次运行的环境在离开时回收, 下一次进入无需等待
+        if (vm)
+        {
+            unref(vm->env);
+            unref(vm->init);
+            unref(vm->update);
+            unref(vm->draw);
+            sch_clear(vm->L, vm->scheduler);
+            prof_stop(vm->profiler);
+            vm->reload = {};
+            lua_gc(vm->L, LUA_GCCOLLECT);
+        }
+
+        ctx_swap_memory(&ctx, false);
+        gfx_release_surfaces();
+        gfx_map_cache(false);
+    }
+}
@@ -0,0 +1,87 @@
+#include "script/chunk.h"
+
+#include <cstring>
+#include <iterator>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+namespace t8::script {
+    static constexpr uint8_t CHUNK_MAGIC[] = {'T', '8', 'B', 'C'};
+    static constexpr size_t CHUNK_HEADER_SIZE = sizeof(CHUNK_MAGIC) + 4 + 8;
+
+    static void put_u32(std::vector<uint8_t> &out, uint32_t v) {
+        for (auto i = 0; i < 4; i++)
+            out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+
+    static void put_u64(std::vector<uint8_t> &out, uint64_t v) {
+        for (auto i = 0; i < 8; i++)
+            out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+
+    static uint64_t get_u64(const uint8_t *p, size_t n) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < n; i++)
+            v |= static_cast<uint64_t>(p[i]) << (i * 8);
+        return v;
+    }
+
+    static int write_dump(lua_State *, const void *p, size_t size, void *ud) {
+        auto &out = *static_cast<std::vector<uint8_t> *>(ud);
+        const auto bytes = static_cast<const uint8_t *>(p);
+        out.insert(out.end(), bytes, bytes + size);
+        return 0;
+    }
+
+    uint64_t chunk_hash(std::string_view source) {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (auto c : source)
+            h = (h ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+        return h;
+    }
+
+    bool chunk_compile(std::string_view source, std::vector<uint8_t> &out, std::string &error, bool strip) {
+        auto L = luaL_newstate();
+        if (!L) {
+            error = "not enough memory";
+            return false;
+        }
+
+        out.assign(std::begin(CHUNK_MAGIC), std::end(CHUNK_MAGIC));
+        put_u32(out, LUA_VERSION_NUM);
+        put_u64(out, chunk_hash(source));
+
+        auto ok = luaL_loadbufferx(L, source.data(), source.size(), "=script", "t") == LUA_OK;
+        if (ok) {
+            ok = lua_dump(L, write_dump, &out, strip) == 0;
+            if (!ok)
+                error = "failed to dump bytecode";
+        } else {
+            const auto message = lua_tostring(L, -1);
+            error = message ? message : "unknown error";
+        }
+
+        lua_close(L);
+        if (!ok)
+            out.clear();
+        return ok;
+    }
+
+    bool chunk_matches(const std::vector<uint8_t> &bytecode, std::string_view source) {
+        if (bytecode.size() <= CHUNK_HEADER_SIZE ||
+            std::memcmp(bytecode.data(), CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0)
+            return false;
+
+        const auto p = bytecode.data() + sizeof(CHUNK_MAGIC);
+        return get_u64(p, 4) == LUA_VERSION_NUM && get_u64(p + 4, 8) == chunk_hash(source);
+    }
+
+    std::string_view chunk_code(const std::vector<uint8_t> &bytecode) {
+        if (bytecode.size() <= CHUNK_HEADER_SIZE)
+            return {};
+        return {reinterpret_cast<const char *>(bytecode.data()) + CHUNK_HEADER_SIZE, bytecode.size() - CHUNK_HEADER_SIZE};
+    }
+}
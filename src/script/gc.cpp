@@ -0,0 +1,58 @@
+#include "script/gc.h"
+
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+#include <lua.h>
+}
+
+namespace t8::script {
+    bool gc_profile(std::string_view name, GcProfile &profile) {
+        if (name == "generational") {
+            profile = GC_GENERATIONAL;
+        } else if (name == "smooth") {
+            profile = GC_SMOOTH;
+        } else if (name == "throughput") {
+            profile = GC_THROUGHPUT;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void gc_apply(lua_State *L, const GcProfile &profile) {
+        if (profile.mode == GcMode::Generational)
+            lua_gc(L, LUA_GCGEN, profile.minormul, profile.majormul);
+        else
+            lua_gc(L, LUA_GCINC, profile.pause, profile.stepmul, profile.stepsize);
+        lua_gc(L, LUA_GCRESTART);
+    }
+
+    void gc_idle(lua_State *L, const GcProfile &profile, GcStats &stats) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto budget = std::chrono::microseconds(profile.budget_us);
+
+        stats.steps = 0;
+        while (std::chrono::steady_clock::now() - start < budget) {
+            stats.steps += 1;
+            if (lua_gc(L, LUA_GCSTEP, 0)) {
+                stats.cycles += 1;
+                break;
+            }
+            // 分代模式下每次步进即一次完整的次级回收
+            if (profile.mode == GcMode::Generational)
+                break;
+        }
+
+        stats.step_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        stats.step_us_max = std::max(stats.step_us_max, stats.step_us);
+        stats.heap_bytes = gc_heap_bytes(L);
+    }
+
+    size_t gc_heap_bytes(lua_State *L) {
+        return (static_cast<size_t>(lua_gc(L, LUA_GCCOUNT)) << 10) + lua_gc(L, LUA_GCCOUNTB);
+    }
+}
@@ -0,0 +1,146 @@
+#include "script/heap.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace t8::script {
+    static inline size_t class_of(size_t size) {
+        if (size <= 256)
+            return (std::max<size_t>(size, 1) - 1) >> 4;
+        return 16 + ((size - 257) >> 6);
+    }
+
+    static inline size_t class_size(size_t index) {
+        if (index < 16)
+            return (index + 1) << 4;
+        return 256 + ((index - 15) << 6);
+    }
+
+    static void *pool_take(ScriptHeap &h, size_t index) {
+        auto &head = h.free_lists[index];
+        if (head) {
+            auto block = head;
+            head = *static_cast<void **>(block);
+            return block;
+        }
+
+        const auto size = class_size(index);
+        if (h.cursor == nullptr || h.cursor + size > h.end) {
+            // arena 末尾不足一块的部分直接丢弃, 至多 1KB
+            h.arenas.emplace_back(new (std::nothrow) uint8_t[HEAP_ARENA_SIZE]);
+            if (!h.arenas.back()) {
+                h.arenas.pop_back();
+                h.cursor = h.end = nullptr;
+                return nullptr;
+            }
+            h.cursor = h.arenas.back().get();
+            h.end = h.cursor + HEAP_ARENA_SIZE;
+        }
+
+        auto block = h.cursor;
+        h.cursor += size;
+        return block;
+    }
+
+    static void pool_give(ScriptHeap &h, void *block, size_t index) {
+        *static_cast<void **>(block) = h.free_lists[index];
+        h.free_lists[index] = block;
+    }
+
+    static void *block_alloc(ScriptHeap &h, size_t size) {
+        return size <= HEAP_SMALL_MAX ? pool_take(h, class_of(size)) : std::malloc(size);
+    }
+
+    static bool in_arena(const ScriptHeap &h, const void *block) {
+        const auto p = reinterpret_cast<uintptr_t>(block);
+        for (const auto &arena : h.arenas) {
+            const auto base = reinterpret_cast<uintptr_t>(arena.get());
+            if (p >= base && p < base + HEAP_ARENA_SIZE)
+                return true;
+        }
+        return false;
+    }
+
+    static void block_free(ScriptHeap &h, void *block, size_t size) {
+        if (size > HEAP_SMALL_MAX) {
+            std::free(block);
+            return;
+        }
+
+        // 只有出现过收缩失败时才需要逐个 arena 比对地址
+        if (h.strays && !in_arena(h, block)) {
+            h.strays -= 1;
+            std::free(block);
+            return;
+        }
+
+        pool_give(h, block, class_of(size));
+    }
+
+    void *heap_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+        auto &h = *static_cast<ScriptHeap *>(ud);
+
+        // ptr 为空时 osize 表示对象类型而非大小
+        if (!ptr)
+            osize = 0;
+
+        if (nsize == 0) {
+            if (ptr) {
+                block_free(h, ptr, osize);
+                h.stats.live -= osize;
+                h.stats.frees += 1;
+                h.stats.frame_frees += 1;
+            }
+            return nullptr;
+        }
+
+        // 收缩不能失败, 只有增长才受上限约束
+        if (nsize > osize && h.limit && h.stats.live - osize + nsize > h.limit) {
+            h.stats.refused += 1;
+            return nullptr;
+        }
+
+        void *block;
+        if (ptr && osize > HEAP_SMALL_MAX && nsize > HEAP_SMALL_MAX) {
+            block = std::realloc(ptr, nsize);
+            if (!block)
+                return nullptr;
+        } else if (ptr && osize <= HEAP_SMALL_MAX && nsize <= HEAP_SMALL_MAX && class_of(osize) == class_of(nsize)) {
+            block = ptr;
+        } else {
+            block = block_alloc(h, nsize);
+            if (!block) {
+                // 收缩时新块申请失败则保留原块; 原块来自 malloc 时仍须由 malloc 释放
+                if (nsize <= osize) {
+                    if (osize > HEAP_SMALL_MAX && nsize <= HEAP_SMALL_MAX)
+                        h.strays += 1;
+                    h.stats.live = h.stats.live - osize + nsize;
+                    return ptr;
+                }
+                return nullptr;
+            }
+            if (ptr) {
+                std::memcpy(block, ptr, std::min(osize, nsize));
+                block_free(h, ptr, osize);
+            }
+        }
+
+        if (!ptr) {
+            h.stats.allocs += 1;
+            h.stats.frame_allocs += 1;
+        }
+        h.stats.live = h.stats.live - osize + nsize;
+        h.stats.peak = std::max(h.stats.peak, h.stats.live);
+        return block;
+    }
+
+    void heap_frame(ScriptHeap &h) {
+        h.stats.frame_allocs = 0;
+        h.stats.frame_frees = 0;
+    }
+
+    size_t heap_reserved(const ScriptHeap &h) {
+        return h.arenas.size() * HEAP_ARENA_SIZE;
+    }
+}
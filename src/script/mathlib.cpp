@@ -0,0 +1,143 @@
+#include "script/mathlib.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+namespace t8::script {
+    static constexpr int TABLE_MASK = MATH_TABLE_SIZE - 1;
+
+    // sin 表覆盖一整圈, atan 表覆盖斜率 [0, 1], 各多一项用于插值
+    struct MathTables {
+        std::array<float, MATH_TABLE_SIZE + 1> sin;
+        std::array<float, MATH_TABLE_SIZE + 1> atan;
+
+        MathTables() {
+            const auto tau = 2.0 * std::acos(-1.0);
+            for (auto i = 0; i <= MATH_TABLE_SIZE; i++) {
+                sin[i] = static_cast<float>(-std::sin(tau * i / MATH_TABLE_SIZE));
+                atan[i] = static_cast<float>(std::atan(static_cast<double>(i) / MATH_TABLE_SIZE) / tau);
+            }
+        }
+    };
+
+    static const MathTables tables;
+
+    // x 取 [0, MATH_TABLE_SIZE]; 右端点 (|dx| == |dy|) 归到最后一段以 t = 1 插值, 不读越界
+    static inline float lookup(const std::array<float, MATH_TABLE_SIZE + 1> &table, float x) {
+        const auto i = std::min(static_cast<int>(x), MATH_TABLE_SIZE - 1);
+        const auto t = x - i;
+        return table[i] + (table[i + 1] - table[i]) * t;
+    }
+
+    float math_sin(float turns) {
+        const auto x = (turns - std::floor(turns)) * MATH_TABLE_SIZE;
+        const auto i = static_cast<int>(x);
+        const auto t = x - i;
+        const auto a = tables.sin[i & TABLE_MASK];
+        const auto b = tables.sin[(i & TABLE_MASK) + 1];
+        return a + (b - a) * t;
+    }
+
+    float math_cos(float turns) {
+        return -math_sin(turns + 0.25f);
+    }
+
+    float math_atan2(float dx, float dy) {
+        if (dx == 0 && dy == 0)
+            return 0.25f;
+
+        // 折算到第一象限内斜率不超过 1 的部分, 再按象限还原
+        const auto ax = std::fabs(dx);
+        const auto ay = std::fabs(dy);
+        auto a = ax >= ay
+                     ? lookup(tables.atan, ay / ax * MATH_TABLE_SIZE)
+                     : 0.25f - lookup(tables.atan, ax / ay * MATH_TABLE_SIZE);
+
+        if (dx < 0)
+            a = 0.5f - a;
+        // y 轴向下, 因此 dy > 0 对应顺时针方向
+        if (dy > 0)
+            a = 1.0f - a;
+        return a >= 1.0f ? a - 1.0f : a;
+    }
+
+    static int l_sin(lua_State *L) {
+        lua_pushnumber(L, math_sin(static_cast<float>(luaL_checknumber(L, 1))));
+        return 1;
+    }
+
+    static int l_cos(lua_State *L) {
+        lua_pushnumber(L, math_cos(static_cast<float>(luaL_checknumber(L, 1))));
+        return 1;
+    }
+
+    static int l_atan2(lua_State *L) {
+        lua_pushnumber(L, math_atan2(static_cast<float>(luaL_checknumber(L, 1)), static_cast<float>(luaL_checknumber(L, 2))));
+        return 1;
+    }
+
+    static int l_flr(lua_State *L) {
+        if (lua_isinteger(L, 1)) {
+            lua_settop(L, 1);
+            return 1;
+        }
+        lua_pushinteger(L, static_cast<lua_Integer>(std::floor(luaL_checknumber(L, 1))));
+        return 1;
+    }
+
+    // 三者居中的值; 全为整数时结果保持整数
+    static int l_mid(lua_State *L) {
+        if (lua_isinteger(L, 1) && lua_isinteger(L, 2) && lua_isinteger(L, 3)) {
+            auto a = lua_tointeger(L, 1);
+            auto b = lua_tointeger(L, 2);
+            const auto c = lua_tointeger(L, 3);
+            if (a > b)
+                std::swap(a, b);
+            lua_pushinteger(L, c < a ? a : (c > b ? b : c));
+            return 1;
+        }
+
+        auto a = luaL_checknumber(L, 1);
+        auto b = luaL_checknumber(L, 2);
+        const auto c = luaL_checknumber(L, 3);
+        if (a > b)
+            std::swap(a, b);
+        lua_pushnumber(L, c < a ? a : (c > b ? b : c));
+        return 1;
+    }
+
+    static int l_sgn(lua_State *L) {
+        lua_pushinteger(L, luaL_checknumber(L, 1) < 0 ? -1 : 1);
+        return 1;
+    }
+
+    static int l_lerp(lua_State *L) {
+        const auto a = luaL_checknumber(L, 1);
+        const auto b = luaL_checknumber(L, 2);
+        lua_pushnumber(L, a + (b - a) * luaL_checknumber(L, 3));
+        return 1;
+    }
+
+    static const luaL_Reg math_api[] = {
+        {"sin", l_sin},
+        {"cos", l_cos},
+        {"atan2", l_atan2},
+        {"flr", l_flr},
+        {"mid", l_mid},
+        {"sgn", l_sgn},
+        {"lerp", l_lerp},
+        {nullptr, nullptr},
+    };
+
+    int luaopen_t8math(lua_State *L) {
+        luaL_newlib(L, math_api);
+        return 1;
+    }
+}
@@ -0,0 +1,157 @@
+#include "script/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+extern "C" {
+#include <lua.h>
+}
+
+namespace t8::script {
+    static uint16_t intern(Profiler &p, const lua_Debug &ar) {
+        const void *source = ar.source;
+        const void *name = ar.name;
+
+        auto h = reinterpret_cast<uintptr_t>(source) ^ (reinterpret_cast<uintptr_t>(name) * 31) ^ (ar.linedefined * 0x9E3779B1u);
+        h ^= h >> 17;
+
+        // 开放寻址, 槽位中保存 funcs 下标加一
+        for (size_t i = 0; i < PROF_SLOT_COUNT; i++) {
+            auto &slot = p.slots[(h + i) & (PROF_SLOT_COUNT - 1)];
+            if (slot == 0) {
+                if (p.funcs.size() >= PROF_MAX_FUNCS)
+                    return 0;
+                slot = static_cast<uint16_t>(p.funcs.size() + 1);
+                break;
+            }
+            const auto &f = p.funcs[slot - 1];
+            if (f.source == source && f.line == ar.linedefined && f.name == name)
+                return static_cast<uint16_t>(slot - 1);
+        }
+
+        // 标签中不能出现折叠栈的分隔符
+        char buffer[ProfLabel::capacity() + 1];
+        int n;
+        if (ar.what && ar.what[0] == 'C')
+            n = std::snprintf(buffer, sizeof(buffer), "[C]%s", ar.name ? ar.name : "?");
+        else
+            n = std::snprintf(buffer, sizeof(buffer), "%s:%d", ar.name ? ar.name : ar.short_src, ar.linedefined);
+        // snprintf 返回的是未截断长度, 只处理实际写入的部分
+        n = std::clamp(n, 0, static_cast<int>(sizeof(buffer)) - 1);
+        buffer[n] = '\0';
+        for (int i = 0; i < n; i++)
+            if (buffer[i] == ';' || buffer[i] == ' ')
+                buffer[i] = '_';
+
+        p.funcs.push_back({source, name, ar.linedefined, ProfLabel(buffer)});
+        return static_cast<uint16_t>(p.funcs.size() - 1);
+    }
+
+    void prof_start(Profiler &p, int interval) {
+        p.funcs.clear();
+        p.funcs.reserve(PROF_MAX_FUNCS);
+        p.funcs.push_back({nullptr, nullptr, -1, ProfLabel("(overflow)")});
+        std::fill(std::begin(p.slots), std::end(p.slots), 0);
+        p.samples.resize(PROF_RING_SIZE);
+        p.head = 0;
+        p.count = 0;
+        p.total = 0;
+        p.interval = std::max(interval, 1);
+        p.running = true;
+    }
+
+    void prof_stop(Profiler &p) {
+        p.running = false;
+    }
+
+    void prof_sample(Profiler &p, lua_State *L) {
+        if (!p.running || p.samples.empty())
+            return;
+
+        auto &sample = p.samples[(p.head + p.count) % p.samples.size()];
+        if (p.count == p.samples.size())
+            p.head = (p.head + 1) % p.samples.size();
+        else
+            p.count += 1;
+        p.total += 1;
+
+        lua_Debug ar;
+        sample.depth = 0;
+        for (auto level = 0; sample.depth < PROF_MAX_DEPTH && lua_getstack(L, level, &ar); level++) {
+            lua_getinfo(L, "Sn", &ar);
+            sample.frames[sample.depth++] = intern(p, ar);
+        }
+    }
+
+    std::string prof_folded(const Profiler &p) {
+        std::unordered_map<std::string, uint64_t> stacks;
+        std::string key;
+
+        for (size_t i = 0; i < p.count; i++) {
+            const auto &sample = p.samples[(p.head + i) % p.samples.size()];
+            key.clear();
+            for (auto d = sample.depth; d > 0; d--) {
+                if (!key.empty())
+                    key += ';';
+                key += p.funcs[sample.frames[d - 1]].label.view();
+            }
+            if (!key.empty())
+                stacks[key] += 1;
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+        std::sort(sorted.begin(), sorted.end());
+
+        std::string out;
+        for (const auto &[stack, n] : sorted) {
+            out += stack;
+            out += ' ';
+            out += std::to_string(n);
+            out += '\n';
+        }
+        return out;
+    }
+
+    bool prof_save(const Profiler &p, const std::string &file_name) {
+        std::ofstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+        file << prof_folded(p);
+        return file.good();
+    }
+
+    std::vector<ProfEntry> prof_top(const Profiler &p, size_t n) {
+        std::vector<ProfEntry> entries(p.funcs.size());
+        for (size_t i = 0; i < entries.size(); i++)
+            entries[i] = {&p.funcs[i], 0, 0};
+
+        std::vector<bool> seen(p.funcs.size());
+        for (size_t i = 0; i < p.count; i++) {
+            const auto &sample = p.samples[(p.head + i) % p.samples.size()];
+            if (sample.depth == 0)
+                continue;
+
+            entries[sample.frames[0]].self += 1;
+
+            // 递归时同一函数在一个样本中只计一次
+            std::fill(seen.begin(), seen.end(), false);
+            for (auto d = 0; d < sample.depth; d++) {
+                if (!seen[sample.frames[d]]) {
+                    seen[sample.frames[d]] = true;
+                    entries[sample.frames[d]].inclusive += 1;
+                }
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const ProfEntry &a, const ProfEntry &b) {
+            return a.self > b.self;
+        });
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const ProfEntry &e) { return e.self == 0; }), entries.end());
+        if (entries.size() > n)
+            entries.resize(n);
+        return entries;
+    }
+}
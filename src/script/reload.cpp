@@ -0,0 +1,109 @@
+#include "script/reload.h"
+#include "script/chunk.h"
+
+#include <cstring>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+namespace t8::script {
+    static void join_upvalues(lua_State *L, int fresh, int old) {
+        for (auto i = 1;; i++) {
+            const auto name = lua_getupvalue(L, fresh, i);
+            if (!name)
+                break;
+            lua_pop(L, 1);
+            if (!*name || std::strcmp(name, "_ENV") == 0)
+                continue;
+
+            for (auto j = 1;; j++) {
+                const auto old_name = lua_getupvalue(L, old, j);
+                if (!old_name)
+                    break;
+                const auto keep = std::strcmp(name, old_name) == 0 && !lua_isfunction(L, -1);
+                lua_pop(L, 1);
+                if (keep) {
+                    lua_upvaluejoin(L, fresh, i, old, j);
+                    break;
+                }
+            }
+        }
+    }
+
+    // 将 src 表合并入 dst 表, 两者均为绝对栈索引
+    static void merge(lua_State *L, int dst, int src, int depth) {
+        lua_pushnil(L);
+        while (lua_next(L, src)) {
+            const auto key = lua_absindex(L, -2);
+            const auto value = lua_absindex(L, -1);
+
+            lua_pushvalue(L, key);
+            lua_rawget(L, dst);
+            const auto old = lua_absindex(L, -1);
+
+            auto replace = lua_isnil(L, old);
+            if (lua_isfunction(L, value)) {
+                if (lua_isfunction(L, old) && !lua_iscfunction(L, old) && !lua_iscfunction(L, value))
+                    join_upvalues(L, value, old);
+                replace = true;
+            } else if (depth > 0 && lua_istable(L, value) && lua_istable(L, old)) {
+                merge(L, old, value, depth - 1);
+            }
+
+            if (replace) {
+                lua_pushvalue(L, key);
+                lua_pushvalue(L, value);
+                lua_rawset(L, dst);
+            }
+
+            lua_pop(L, 2);
+        }
+    }
+
+    std::future<ReloadResult> rld_compile(std::string source) {
+        return std::async(std::launch::async, [source = std::move(source)]() mutable {
+            ReloadResult result;
+            result.ok = chunk_compile(source, result.bytecode, result.error, false);
+            result.source = std::move(source);
+            return result;
+        });
+    }
+
+    bool rld_apply(lua_State *L, int env, const std::vector<uint8_t> &bytecode, std::string &error) {
+        env = lua_absindex(L, env);
+
+        const auto code = chunk_code(bytecode);
+        if (luaL_loadbufferx(L, code.data(), code.size(), "=script", "b") != LUA_OK) {
+            const auto message = lua_tostring(L, -1);
+            error = message ? message : "unknown error";
+            lua_pop(L, 1);
+            return false;
+        }
+
+        // staging = setmetatable({}, {__index = env})
+        lua_newtable(L);
+        lua_newtable(L);
+        lua_pushvalue(L, env);
+        lua_setfield(L, -2, "__index");
+        lua_setmetatable(L, -2);
+        const auto staging = lua_absindex(L, -1);
+
+        lua_pushvalue(L, staging);
+        if (!lua_setupvalue(L, staging - 1, 1))
+            lua_pop(L, 1);
+
+        lua_pushvalue(L, staging - 1);
+        if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+            const auto message = lua_tostring(L, -1);
+            error = message ? message : "unknown error";
+            lua_pop(L, 3);
+            return false;
+        }
+
+        merge(L, env, staging, 1);
+        lua_pop(L, 2);
+        return true;
+    }
+}
@@ -0,0 +1,160 @@
+#include "script/scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+namespace t8::script {
+    static bool later(const SchedTask &a, const SchedTask &b) {
+        return a.wake != b.wake ? a.wake > b.wake : a.seq > b.seq;
+    }
+
+    static void push(Scheduler &s, uint64_t wake, int ref, uint32_t period) {
+        s.heap.push_back({wake, s.seq++, ref, period});
+        std::push_heap(s.heap.begin(), s.heap.end(), later);
+    }
+
+    static SchedTask pop(Scheduler &s) {
+        std::pop_heap(s.heap.begin(), s.heap.end(), later);
+        const auto task = s.heap.back();
+        s.heap.pop_back();
+        return task;
+    }
+
+    static lua_Integer ticks_at(lua_State *L, int i, lua_Integer def) {
+        if (lua_isnoneornil(L, i))
+            return def;
+        int isnum;
+        const auto v = lua_tointegerx(L, i, &isnum);
+        return isnum ? v : static_cast<lua_Integer>(std::floor(luaL_checknumber(L, i)));
+    }
+
+    // 以栈上 fn_index 处的函数创建协程, 并在 wake 时首次唤醒
+    static void spawn_at(lua_State *L, Scheduler &s, int fn_index, uint64_t wake) {
+        luaL_checktype(L, fn_index, LUA_TFUNCTION);
+        auto co = lua_newthread(L);
+        lua_pushvalue(L, fn_index);
+        lua_xmove(L, co, 1);
+        push(s, wake, luaL_ref(L, LUA_REGISTRYINDEX), 0);
+    }
+
+    int sch_spawn(lua_State *L, Scheduler &s) {
+        spawn_at(L, s, 1, s.tick);
+        return 0;
+    }
+
+    int sch_after(lua_State *L, Scheduler &s) {
+        const auto n = std::max<lua_Integer>(ticks_at(L, 1, 1), 1);
+        spawn_at(L, s, 2, s.tick + n);
+        return 0;
+    }
+
+    int sch_every(lua_State *L, Scheduler &s) {
+        const auto n = std::max<lua_Integer>(ticks_at(L, 1, 1), 1);
+        luaL_checktype(L, 2, LUA_TFUNCTION);
+        lua_pushvalue(L, 2);
+        push(s, s.tick + n, luaL_ref(L, LUA_REGISTRYINDEX), static_cast<uint32_t>(n));
+        return 0;
+    }
+
+    int sch_wait(lua_State *L) {
+        if (!lua_isyieldable(L))
+            return luaL_error(L, "wait() called outside spawn()");
+        lua_pushinteger(L, std::max<lua_Integer>(ticks_at(L, 1, 1), 1));
+        return lua_yield(L, 1);
+    }
+
+    static int traceback(lua_State *L) {
+        luaL_traceback(L, L, lua_tostring(L, 1), 1);
+        return 1;
+    }
+
+    static bool fail(lua_State *L, std::string &error) {
+        const auto message = lua_tostring(L, -1);
+        error = message ? message : "(error object is not a string)";
+        lua_pop(L, 1);
+        return false;
+    }
+
+    static bool resume(lua_State *L, Scheduler &s, const SchedTask &task, std::string &error) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, task.ref);
+        auto co = lua_tothread(L, -1);
+        lua_pop(L, 1);
+
+        // 协程沿用主线程的钩子, 使看门狗与性能分析同样覆盖协程
+        lua_sethook(co, lua_gethook(L), lua_gethookmask(L), lua_gethookcount(L));
+
+        int nres;
+        const auto status = lua_resume(co, L, 0, &nres);
+        if (status == LUA_YIELD) {
+            int isnum;
+            const auto n = nres > 0 ? lua_tointegerx(co, -nres, &isnum) : 1;
+            lua_pop(co, nres);
+            push(s, s.tick + std::max<lua_Integer>(n, 1), task.ref, 0);
+            return true;
+        }
+
+        if (status != LUA_OK) {
+            luaL_traceback(L, co, lua_tostring(co, -1), 0);
+            luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+            return fail(L, error);
+        }
+
+        luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+        return true;
+    }
+
+    static bool call(lua_State *L, Scheduler &s, const SchedTask &task, std::string &error) {
+        lua_pushcfunction(L, traceback);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, task.ref);
+        if (lua_pcall(L, 0, 1, -2) != LUA_OK) {
+            lua_remove(L, -2);
+            luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+            return fail(L, error);
+        }
+
+        const auto stop = lua_isboolean(L, -1) && !lua_toboolean(L, -1);
+        lua_pop(L, 2);
+
+        if (stop)
+            luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+        else
+            push(s, s.tick + task.period, task.ref, task.period);
+        return true;
+    }
+
+    bool sch_run(lua_State *L, Scheduler &s, std::string &error) {
+        // 本 tick 中新加入的任务留到下一 tick, 避免相互 spawn 时无法结束
+        const auto first_new = s.seq;
+
+        s.resumed = 0;
+        while (!s.heap.empty() && s.heap.front().wake <= s.tick && s.heap.front().seq < first_new) {
+            const auto task = pop(s);
+            s.resumed += 1;
+
+            const auto ok = task.period ? call(L, s, task, error) : resume(L, s, task, error);
+            if (!ok)
+                return false;
+        }
+
+        s.tick += 1;
+        return true;
+    }
+
+    void sch_clear(lua_State *L, Scheduler &s) {
+        for (const auto &task : s.heap)
+            luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+        s.heap.clear();
+        s.tick = 0;
+        s.seq = 0;
+        s.resumed = 0;
+    }
+
+    size_t sch_pending(const Scheduler &s) {
+        return s.heap.size();
+    }
+}
@@ -0,0 +1,26 @@
+#include "script/watchdog.h"
+
+namespace t8::script {
+    void wd_arm(Watchdog &w, const char *callback) {
+        w.armed = true;
+        w.callback = callback;
+        w.executed = 0;
+        w.start = std::chrono::steady_clock::now();
+    }
+
+    void wd_disarm(Watchdog &w) {
+        w.armed = false;
+    }
+
+    bool wd_check(Watchdog &w, int instructions) {
+        if (!w.armed)
+            return false;
+
+        w.executed += instructions;
+        if (w.budget_instructions && w.executed > w.budget_instructions)
+            return true;
+
+        return w.budget_ms &&
+               std::chrono::steady_clock::now() - w.start > std::chrono::milliseconds(w.budget_ms);
+    }
+}
@@ -0,0 +1,23 @@
+#include "utils/crc32.h"
+
+#include <array>
+
+namespace t8::utils {
+    static constexpr auto CRC_TABLE = []() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            auto c = i;
+            for (auto k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc) {
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+}
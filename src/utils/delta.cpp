@@ -0,0 +1,72 @@
+#include "utils/delta.h"
+#include "utils/varint.hpp"
+
+#include <cstring>
+
+namespace t8::utils {
+    static inline bool word_equal(const uint8_t *a, const uint8_t *b) {
+        uint64_t x, y;
+        std::memcpy(&x, a, 8);
+        std::memcpy(&y, b, 8);
+        return x == y;
+    }
+
+    // 最坏情况: 每个字节都不同, 只多出少量游程头
+    size_t delta_bound(size_t n) {
+        return n + n / 8 + VARINT_MAX_BYTES * 4;
+    }
+
+    size_t delta_encode(uint8_t *out, const uint8_t *cur, const uint8_t *prev, size_t n) {
+        auto p = out;
+        size_t i = 0;
+
+        do {
+            const auto same_start = i;
+            while (i + 8 <= n && word_equal(cur + i, prev + i))
+                i += 8;
+            while (i < n && cur[i] == prev[i])
+                i++;
+
+            const auto diff_start = i;
+            while (i < n) {
+                if (cur[i] == prev[i] && (i + 8 > n || word_equal(cur + i, prev + i)))
+                    break;
+                i++;
+            }
+
+            p += varint_write(p, diff_start - same_start);
+            p += varint_write(p, i - diff_start);
+            for (auto j = diff_start; j < i; j++)
+                *(p++) = cur[j] ^ prev[j];
+        } while (i < n);
+
+        return p - out;
+    }
+
+    bool delta_apply(uint8_t *dst, const uint8_t *in, size_t size, size_t n) {
+        const auto end = in + size;
+        size_t i = 0;
+
+        while (in < end && i < n) {
+            uint64_t same, diff;
+            auto k = varint_read(in, end, same);
+            if (!k)
+                return false;
+            in += k;
+            k = varint_read(in, end, diff);
+            if (!k)
+                return false;
+            in += k;
+
+            i += same;
+            if (i + diff > n || in + diff > end)
+                return false;
+            for (size_t j = 0; j < diff; j++)
+                dst[i + j] ^= in[j];
+            i += diff;
+            in += diff;
+        }
+
+        return in == end;
+    }
+}
@@ -0,0 +1,274 @@
+#include "utils/inflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace t8::utils {
+    static constexpr int MAX_BITS = 15;
+    static constexpr int MAX_LCODES = 286;
+    static constexpr int MAX_DCODES = 30;
+    static constexpr int FIXED_LCODES = 288;
+
+    // 范式 Huffman 表: 各长度的码数与按码值排列的符号
+    struct Huffman {
+        uint16_t count[MAX_BITS + 1];
+        uint16_t symbol[FIXED_LCODES];
+    };
+
+    struct InflateState {
+        const uint8_t *in;
+        size_t in_size;
+        size_t in_pos;
+        uint32_t bit_buf;
+        int bit_count;
+
+        uint8_t *out;
+        size_t out_cap;
+        size_t out_pos;
+
+        // 输入耗尽或数据无效
+        bool error;
+    };
+
+    static int bits(InflateState &s, int need) {
+        auto v = s.bit_buf;
+        while (s.bit_count < need) {
+            if (s.in_pos == s.in_size) {
+                s.error = true;
+                return 0;
+            }
+            v |= static_cast<uint32_t>(s.in[s.in_pos++]) << s.bit_count;
+            s.bit_count += 8;
+        }
+        s.bit_buf = v >> need;
+        s.bit_count -= need;
+        return static_cast<int>(v & ((1u << need) - 1));
+    }
+
+    // 逐位比较各长度的首个码值, 返回符号, 无效时返回 -1
+    static int decode(InflateState &s, const Huffman &h) {
+        int code = 0, first = 0, index = 0;
+        for (auto len = 1; len <= MAX_BITS; len++) {
+            code |= bits(s, 1);
+            if (s.error)
+                return -1;
+            const int count = h.count[len];
+            if (code - count < first)
+                return h.symbol[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    // 返回值 < 0 表示码长超额, > 0 表示码表不完整
+    static int construct(Huffman &h, const uint8_t *lengths, int n) {
+        std::fill(std::begin(h.count), std::end(h.count), 0);
+        for (auto i = 0; i < n; i++)
+            h.count[lengths[i]] += 1;
+        if (h.count[0] == n)
+            return 0;
+
+        auto left = 1;
+        for (auto len = 1; len <= MAX_BITS; len++) {
+            left <<= 1;
+            left -= h.count[len];
+            if (left < 0)
+                return left;
+        }
+
+        uint16_t offsets[MAX_BITS + 1];
+        offsets[1] = 0;
+        for (auto len = 1; len < MAX_BITS; len++)
+            offsets[len + 1] = offsets[len] + h.count[len];
+
+        for (auto i = 0; i < n; i++)
+            if (lengths[i])
+                h.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+        return left;
+    }
+
+    static constexpr uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr uint16_t DIST_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+        6145, 8193, 12289, 16385, 24577};
+    static constexpr uint8_t DIST_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    static bool full(const InflateState &s) {
+        return s.out_pos == s.out_cap;
+    }
+
+    static bool codes(InflateState &s, const Huffman &lencode, const Huffman &distcode) {
+        while (!full(s)) {
+            auto symbol = decode(s, lencode);
+            if (symbol < 0)
+                return false;
+
+            if (symbol < 256) {
+                s.out[s.out_pos++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256)
+                return true;
+
+            symbol -= 257;
+            if (symbol >= 29)
+                return false;
+            const size_t len = LENGTH_BASE[symbol] + bits(s, LENGTH_EXTRA[symbol]);
+
+            symbol = decode(s, distcode);
+            if (symbol < 0 || symbol >= 30)
+                return false;
+            const size_t dist = DIST_BASE[symbol] + bits(s, DIST_EXTRA[symbol]);
+            if (s.error || dist > s.out_pos)
+                return false;
+
+            // 复制区间可能与自身重叠, 必须逐字节复制
+            const auto n = std::min(len, s.out_cap - s.out_pos);
+            auto p = s.out + s.out_pos;
+            for (size_t i = 0; i < n; i++)
+                p[i] = p[i - dist];
+            s.out_pos += n;
+        }
+        return true;
+    }
+
+    static bool stored(InflateState &s) {
+        s.bit_buf = 0;
+        s.bit_count = 0;
+
+        if (s.in_pos + 4 > s.in_size)
+            return false;
+        const auto len = s.in[s.in_pos] | (s.in[s.in_pos + 1] << 8);
+        const auto nlen = s.in[s.in_pos + 2] | (s.in[s.in_pos + 3] << 8);
+        s.in_pos += 4;
+        if (len != (~nlen & 0xFFFF) || s.in_pos + len > s.in_size)
+            return false;
+
+        const auto n = std::min(static_cast<size_t>(len), s.out_cap - s.out_pos);
+        std::memcpy(s.out + s.out_pos, s.in + s.in_pos, n);
+        s.out_pos += n;
+        s.in_pos += len;
+        return true;
+    }
+
+    static bool fixed(InflateState &s) {
+        static Huffman lencode, distcode;
+        static const bool built = [] {
+            uint8_t lengths[FIXED_LCODES];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + FIXED_LCODES, 8);
+            construct(lencode, lengths, FIXED_LCODES);
+
+            std::fill(lengths, lengths + MAX_DCODES, 5);
+            construct(distcode, lengths, MAX_DCODES);
+            return true;
+        }();
+        (void)built;
+
+        return codes(s, lencode, distcode);
+    }
+
+    static bool dynamic(InflateState &s) {
+        static constexpr uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        const auto nlen = bits(s, 5) + 257;
+        const auto ndist = bits(s, 5) + 1;
+        const auto ncode = bits(s, 4) + 4;
+        if (s.error || nlen > MAX_LCODES || ndist > MAX_DCODES)
+            return false;
+
+        uint8_t lengths[MAX_LCODES + MAX_DCODES]{0};
+        for (auto i = 0; i < ncode; i++)
+            lengths[ORDER[i]] = static_cast<uint8_t>(bits(s, 3));
+
+        Huffman lencode, distcode;
+        if (s.error || construct(lencode, lengths, 19) != 0)
+            return false;
+
+        for (auto i = 0; i < nlen + ndist;) {
+            const auto symbol = decode(s, lencode);
+            if (symbol < 0)
+                return false;
+            if (symbol < 16) {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            uint8_t len = 0;
+            int repeat;
+            if (symbol == 16) {
+                if (i == 0)
+                    return false;
+                len = lengths[i - 1];
+                repeat = 3 + bits(s, 2);
+            } else if (symbol == 17) {
+                repeat = 3 + bits(s, 3);
+            } else {
+                repeat = 11 + bits(s, 7);
+            }
+            if (s.error || i + repeat > nlen + ndist)
+                return false;
+            while (repeat--)
+                lengths[i++] = len;
+        }
+
+        // 必须有结束符; 不完整的码表只允许只有一个码的情况
+        if (lengths[256] == 0)
+            return false;
+
+        auto err = construct(lencode, lengths, nlen);
+        if (err && (err < 0 || nlen != lencode.count[0] + lencode.count[1]))
+            return false;
+
+        err = construct(distcode, lengths + nlen, ndist);
+        if (err && (err < 0 || ndist != distcode.count[0] + distcode.count[1]))
+            return false;
+
+        return codes(s, lencode, distcode);
+    }
+
+    bool inflate(uint8_t *dst, size_t cap, const uint8_t *src, size_t size, size_t &written) {
+        InflateState s{src, size, 0, 0, 0, dst, cap, 0, false};
+
+        auto ok = true;
+        auto last = 0;
+        while (ok && !last && !full(s)) {
+            last = bits(s, 1);
+            const auto type = bits(s, 2);
+            if (s.error)
+                break;
+
+            switch (type) {
+            case 0:
+                ok = stored(s);
+                break;
+            case 1:
+                ok = fixed(s);
+                break;
+            case 2:
+                ok = dynamic(s);
+                break;
+            default:
+                ok = false;
+                break;
+            }
+        }
+
+        written = s.out_pos;
+        return ok && !s.error;
+    }
+}
@@ -0,0 +1,72 @@
+#include "utils/png.h"
+#include "utils/crc32.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace t8::utils {
+    static void put_u32(std::vector<uint8_t> &out, uint32_t v) {
+        out.push_back(static_cast<uint8_t>(v >> 24));
+        out.push_back(static_cast<uint8_t>(v >> 16));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    static void put_chunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+        put_u32(out, static_cast<uint32_t>(data.size()));
+        const auto start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put_u32(out, crc32(out.data() + start, out.size() - start));
+    }
+
+    bool png_write(const std::string &file_name, const uint32_t *pixels, uint32_t width, uint32_t height) {
+        std::vector<uint8_t> raw;
+        raw.reserve((width * 4 + 1) * height);
+        for (uint32_t y = 0; y < height; y++) {
+            raw.push_back(0);
+            for (uint32_t x = 0; x < width; x++) {
+                const auto c = pixels[y * width + x];
+                raw.push_back(static_cast<uint8_t>(c >> 24));
+                raw.push_back(static_cast<uint8_t>(c >> 16));
+                raw.push_back(static_cast<uint8_t>(c >> 8));
+                raw.push_back(static_cast<uint8_t>(c));
+            }
+        }
+
+        // zlib 流, 仅使用 stored 块
+        std::vector<uint8_t> z = {0x78, 0x01};
+        uint32_t a = 1, b = 0;
+        for (auto v : raw) {
+            a = (a + v) % 65521;
+            b = (b + a) % 65521;
+        }
+        for (size_t i = 0; i < raw.size() || i == 0; i += 0xFFFF) {
+            const auto n = static_cast<uint16_t>(std::min<size_t>(0xFFFF, raw.size() - i));
+            z.push_back(i + n >= raw.size() ? 1 : 0);
+            z.push_back(n & 0xFF);
+            z.push_back(n >> 8);
+            z.push_back(~n & 0xFF);
+            z.push_back((~n >> 8) & 0xFF);
+            z.insert(z.end(), raw.begin() + i, raw.begin() + i + n);
+        }
+        put_u32(z, (b << 16) | a);
+
+        std::vector<uint8_t> header;
+        put_u32(header, width);
+        put_u32(header, height);
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+
+        std::vector<uint8_t> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        put_chunk(out, "IHDR", header);
+        put_chunk(out, "IDAT", z);
+        put_chunk(out, "IEND", {});
+
+        std::ofstream file(file_name, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char *>(out.data()), out.size());
+        return file.good();
+    }
+}
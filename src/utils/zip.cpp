@@ -0,0 +1,262 @@
+#include "utils/zip.h"
+#include "utils/crc32.h"
+#include "utils/inflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace t8::utils {
+    static constexpr uint32_t LOCAL_MAGIC = 0x04034b50;
+    static constexpr uint32_t CENTRAL_MAGIC = 0x02014b50;
+    static constexpr uint32_t END_MAGIC = 0x06054b50;
+
+    static constexpr size_t LOCAL_SIZE = 30;
+    static constexpr size_t CENTRAL_SIZE = 46;
+    static constexpr size_t END_SIZE = 22;
+
+    static inline uint16_t u16(const uint8_t *p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    static inline uint32_t u32(const uint8_t *p) {
+        return static_cast<uint32_t>(u16(p)) | (static_cast<uint32_t>(u16(p + 2)) << 16);
+    }
+
+    static void put_u16(std::vector<uint8_t> &out, uint16_t v) {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    static void put_u32(std::vector<uint8_t> &out, uint32_t v) {
+        put_u16(out, static_cast<uint16_t>(v));
+        put_u16(out, static_cast<uint16_t>(v >> 16));
+    }
+
+    static bool map_file(ZipArchive &zip, const std::string &file_name) {
+#ifdef _WIN32
+        const auto file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+            return false;
+
+        // 视图在 UnmapViewOfFile 之前一直有效, 句柄可以立即关闭
+        const auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view)
+            return false;
+
+        zip.data = static_cast<const uint8_t *>(view);
+        zip.size = static_cast<size_t>(size.QuadPart);
+#else
+        const auto fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        void *view = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+
+        zip.data = static_cast<const uint8_t *>(view);
+        zip.size = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    // 末尾记录之后可能跟有至多 0xFFFF 字节的注释, 从后向前查找
+    static const uint8_t *find_end(const ZipArchive &zip) {
+        if (zip.size < END_SIZE)
+            return nullptr;
+
+        const auto lowest = zip.size > END_SIZE + 0xFFFF ? zip.size - END_SIZE - 0xFFFF : 0;
+        for (auto i = zip.size - END_SIZE + 1; i-- > lowest;)
+            if (u32(zip.data + i) == END_MAGIC)
+                return zip.data + i;
+        return nullptr;
+    }
+
+    static bool read_directory(ZipArchive &zip) {
+        const auto end = find_end(zip);
+        if (!end)
+            return false;
+
+        const auto count = u16(end + 10);
+        size_t offset = u32(end + 16);
+
+        zip.entries.reserve(count);
+        for (auto i = 0; i < count; i++) {
+            if (offset + CENTRAL_SIZE > zip.size)
+                return false;
+            const auto p = zip.data + offset;
+            if (u32(p) != CENTRAL_MAGIC)
+                return false;
+
+            const auto flags = u16(p + 8);
+            const auto method = u16(p + 10);
+            const auto crc = u32(p + 16);
+            const size_t compressed_size = u32(p + 20);
+            const size_t size = u32(p + 24);
+            const auto name_size = u16(p + 28);
+            const auto extra_size = u16(p + 30);
+            const auto comment_size = u16(p + 32);
+            const size_t local = u32(p + 42);
+
+            if (offset + CENTRAL_SIZE + name_size > zip.size)
+                return false;
+            const std::string_view name(reinterpret_cast<const char *>(p + CENTRAL_SIZE), name_size);
+            offset += CENTRAL_SIZE + name_size + extra_size + comment_size;
+
+            // 数据偏移以本地头中的名字与扩展长度为准, 二者可能与中央目录不同
+            if (local + LOCAL_SIZE > zip.size || u32(zip.data + local) != LOCAL_MAGIC)
+                return false;
+            const auto start = local + LOCAL_SIZE + u16(zip.data + local + 26) + u16(zip.data + local + 28);
+            if (start > zip.size || compressed_size > zip.size - start)
+                return false;
+
+            // 声明的大小超出 deflate 的最大压缩比 (约 1032:1) 时视为损坏, 避免按其分配内存
+            if (size > compressed_size * 1032 + 1032)
+                return false;
+
+            // 跳过目录与加密的条目
+            if ((flags & 1) || name.ends_with('/'))
+                continue;
+
+            zip.entries.push_back({name, method, zip.data + start, compressed_size, size, crc});
+        }
+        return true;
+    }
+
+    ZipArchive::~ZipArchive() {
+        zip_close(*this);
+    }
+
+    bool zip_open(ZipArchive &zip, const std::string &file_name) {
+        zip_close(zip);
+        if (!map_file(zip, file_name))
+            return false;
+        if (read_directory(zip))
+            return true;
+        zip_close(zip);
+        return false;
+    }
+
+    void zip_close(ZipArchive &zip) {
+        if (zip.data) {
+#ifdef _WIN32
+            UnmapViewOfFile(zip.data);
+#else
+            munmap(const_cast<uint8_t *>(zip.data), zip.size);
+#endif
+        }
+        zip.data = nullptr;
+        zip.size = 0;
+        zip.entries.clear();
+    }
+
+    const ZipEntry *zip_find(const ZipArchive &zip, std::string_view name) {
+        for (const auto &entry : zip.entries)
+            if (entry.name == name)
+                return &entry;
+        return nullptr;
+    }
+
+    bool zip_extract(const ZipEntry &entry, uint8_t *dst, size_t cap, size_t &written) {
+        written = 0;
+        if (cap < entry.size)
+            return false;
+
+        switch (entry.method) {
+        case ZIP_STORED:
+            if (entry.compressed_size != entry.size)
+                return false;
+            written = entry.size;
+            if (written)
+                std::memcpy(dst, entry.data, written);
+            break;
+        case ZIP_DEFLATED:
+            if (!inflate(dst, entry.size, entry.data, entry.compressed_size, written))
+                return false;
+            break;
+        default:
+            return false;
+        }
+        return written == entry.size && crc32(dst, written) == entry.crc;
+    }
+
+    // 本地头与中央目录共有的字段: 版本, 标志, 方法, 时间, 日期 (1980-01-01), CRC, 两个大小, 名字长度
+    static void put_header(std::vector<uint8_t> &out, uint32_t crc, uint32_t size, uint16_t name_size) {
+        put_u16(out, 20);
+        put_u16(out, 0);
+        put_u16(out, ZIP_STORED);
+        put_u16(out, 0);
+        put_u16(out, 0x21);
+        put_u32(out, crc);
+        put_u32(out, size);
+        put_u32(out, size);
+        put_u16(out, name_size);
+        put_u16(out, 0);
+    }
+
+    void zip_add(ZipWriter &zip, std::string_view name, const uint8_t *data, size_t size) {
+        const auto crc = crc32(data, size);
+        const auto offset = static_cast<uint32_t>(zip.data.size());
+        const auto name_size = static_cast<uint16_t>(name.size());
+        const auto length = static_cast<uint32_t>(size);
+
+        put_u32(zip.data, LOCAL_MAGIC);
+        put_header(zip.data, crc, length, name_size);
+        zip.data.insert(zip.data.end(), name.begin(), name.end());
+        zip.data.insert(zip.data.end(), data, data + size);
+
+        put_u32(zip.directory, CENTRAL_MAGIC);
+        put_u16(zip.directory, 20);
+        put_header(zip.directory, crc, length, name_size);
+        put_u16(zip.directory, 0);
+        put_u16(zip.directory, 0);
+        put_u16(zip.directory, 0);
+        put_u32(zip.directory, 0);
+        put_u32(zip.directory, offset);
+        zip.directory.insert(zip.directory.end(), name.begin(), name.end());
+
+        zip.count += 1;
+    }
+
+    bool zip_save(const ZipWriter &zip, const std::string &file_name) {
+        std::vector<uint8_t> end;
+        put_u32(end, END_MAGIC);
+        put_u16(end, 0);
+        put_u16(end, 0);
+        put_u16(end, zip.count);
+        put_u16(end, zip.count);
+        put_u32(end, static_cast<uint32_t>(zip.directory.size()));
+        put_u32(end, static_cast<uint32_t>(zip.data.size()));
+        put_u16(end, 0);
+
+        std::ofstream file(file_name, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(zip.data.data()), static_cast<std::streamsize>(zip.data.size()));
+        file.write(reinterpret_cast<const char *>(zip.directory.data()), static_cast<std::streamsize>(zip.directory.size()));
+        file.write(reinterpret_cast<const char *>(end.data()), static_cast<std::streamsize>(end.size()));
+        return static_cast<bool>(file);
+    }
+}
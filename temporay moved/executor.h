@@ -1,13 +0,0 @@
-#pragma once
-
-#include "t8_utils_timer.h"
-
-namespace t8::scene {
-    void executor_update();
-
-    void executor_draw();
-
-    void executor_enter();
-
-    void executor_leave();
-}
\ No newline at end of file